@@ -9,6 +9,12 @@ document.addEventListener('DOMContentLoaded', function() {
     const radioTextInput = document.getElementById('radioText');
     const monoAudioInput = document.getElementById('monoAudio');
     const preEmphTime50Input = document.getElementById('preEmphTime50');
+    const agcEnabledInput = document.getElementById('agcEnabled');
+    const silenceThresholdInput = document.getElementById('silenceThreshold');
+    const silenceHoldMsInput = document.getElementById('silenceHoldMs');
+    const silenceRecoverMsInput = document.getElementById('silenceRecoverMs');
+    const silenceMuteInput = document.getElementById('silenceMute');
+    const fallbackTextInput = document.getElementById('fallbackText');
     const saveBtn = document.getElementById('saveBtn');
     const statusMsg = document.getElementById('statusMsg');
     
@@ -30,6 +36,12 @@ document.addEventListener('DOMContentLoaded', function() {
             radioTextInput.value = data.radioText;
             monoAudioInput.checked = data.monoAudio;
             preEmphTime50Input.checked = data.preEmphTime50;
+            agcEnabledInput.checked = data.agcEnabled;
+            silenceThresholdInput.value = data.silenceThreshold;
+            silenceHoldMsInput.value = data.silenceHoldMs;
+            silenceRecoverMsInput.value = data.silenceRecoverMs;
+            silenceMuteInput.checked = data.silenceMute;
+            fallbackTextInput.value = data.fallbackText;
         })
         .catch(error => {
             console.error('Error fetching settings:', error);
@@ -46,14 +58,20 @@ document.addEventListener('DOMContentLoaded', function() {
         }
         
         const settings = {
-            frequency: frequency,
+            frequency: frequencyInput.value,    // 以字符串发送，固件按定点数解析
             txPower: parseInt(txPowerInput.value),
             txFreqDeviation: parseInt(txFreqDeviationInput.value),
             rdsEnabled: rdsEnabledInput.checked,
             stationName: stationNameInput.value,
             radioText: radioTextInput.value,
             monoAudio: monoAudioInput.checked,
-            preEmphTime50: preEmphTime50Input.checked
+            preEmphTime50: preEmphTime50Input.checked,
+            agcEnabled: agcEnabledInput.checked,
+            silenceThreshold: parseInt(silenceThresholdInput.value),
+            silenceHoldMs: parseInt(silenceHoldMsInput.value),
+            silenceRecoverMs: parseInt(silenceRecoverMsInput.value),
+            silenceMute: silenceMuteInput.checked,
+            fallbackText: fallbackTextInput.value
         };
         
         fetch('/api/settings', {
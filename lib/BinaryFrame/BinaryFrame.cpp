@@ -0,0 +1,97 @@
+/*
+frame on the wire-
+	0x00, COBS( message, CRC16 low byte, CRC16 high byte ), 0x00
+
+COBS replaces every 0x00 inside the frame, so 0x00 only ever appears as delimiter and receiver can
+find frame boundaries without any length field. a frame damaged or cut in the middle costs only that frame,
+next 0x00 starts clean again. leading 0x00 also flushes whatever text was printed on same port before the frame.
+
+CRC is CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), same as python's binascii.crc_hqx(data, 0xFFFF).
+*/
+
+#include <BinaryFrame.h>
+#include <string.h>
+
+uint16_t frameCRC16(const uint8_t *data,size_t len)
+{
+	uint16_t crc = 0xFFFF;
+	while(len--){
+		crc ^= (uint16_t)(*data++) << 8;
+		for(uint8_t i = 0; i < 8; i++){
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+		}
+	}
+	return crc;
+}
+
+/* out must have room for len + len/254 + 1 bytes. returns encoded length, no delimiter is added. */
+size_t cobsEncode(const uint8_t *in,size_t len,uint8_t *out)
+{
+	size_t codeAt = 0;
+	size_t o = 1;
+	uint8_t code = 1;
+	for(size_t i = 0; i < len; i++){
+		if(in[i] == 0){
+			out[codeAt] = code;
+			codeAt = o++;
+			code = 1;
+		}else{
+			out[o++] = in[i];
+			if(++code == 0xFF){
+				out[codeAt] = code;
+				codeAt = o++;
+				code = 1;
+			}
+		}
+	}
+	out[codeAt] = code;
+	return o;
+}
+
+/* returns decoded length, 0 if input is not valid COBS or does not fit in outMax */
+size_t cobsDecode(const uint8_t *in,size_t len,uint8_t *out,size_t outMax)
+{
+	size_t i = 0;
+	size_t o = 0;
+	while(i < len){
+		uint8_t code = in[i++];
+		if(code == 0 || i + code - 1 > len) return 0;
+		for(uint8_t k = 1; k < code; k++){
+			if(o == outMax || in[i] == 0) return 0;
+			out[o++] = in[i++];
+		}
+		if(code != 0xFF && i < len){
+			if(o == outMax) return 0;
+			out[o++] = 0;
+		}
+	}
+	return o;
+}
+
+/* appends CRC and COBS encodes msg (len <= FRAME_MSG_MAX) into out (FRAME_ENCODED_MAX bytes).
+	returns encoded length without delimiters, 0 if msg is too long.
+*/
+size_t frameEncode(const uint8_t *msg,size_t len,uint8_t *out)
+{
+	uint8_t raw[FRAME_MSG_MAX + FRAME_CRC_LEN];
+	if(len > FRAME_MSG_MAX) return 0;
+	memcpy(raw,msg,len);
+	uint16_t crc = frameCRC16(msg,len);
+	raw[len] = crc & 0xFF;
+	raw[len + 1] = crc >> 8;
+	return cobsEncode(raw,len + FRAME_CRC_LEN,out);
+}
+
+/* decodes one frame (bytes between two delimiters) into msg (FRAME_MSG_MAX bytes).
+	returns message length without CRC, 0 when frame is damaged.
+*/
+size_t frameDecode(const uint8_t *in,size_t len,uint8_t *msg)
+{
+	uint8_t raw[FRAME_MSG_MAX + FRAME_CRC_LEN];
+	size_t n = cobsDecode(in,len,raw,sizeof(raw));
+	if(n <= FRAME_CRC_LEN) return 0;
+	n -= FRAME_CRC_LEN;
+	if(frameCRC16(raw,n) != (uint16_t)(raw[n] | (raw[n + 1] << 8))) return 0;
+	memcpy(msg,raw,n);
+	return n;
+}
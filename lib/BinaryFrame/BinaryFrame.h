@@ -0,0 +1,20 @@
+/* COBS framing with CRC-16 for binary messages on a byte stream (USB-CDC serial) */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef BinaryFrame_h
+#define BinaryFrame_h
+
+#define 		FRAME_DELIMITER		  0x00
+#define 		FRAME_CRC_LEN		  2
+#define 		FRAME_MSG_MAX		  96		//message bytes without CRC
+#define 		FRAME_ENCODED_MAX	  (FRAME_MSG_MAX + FRAME_CRC_LEN + 2)	//COBS adds 1 byte per 254
+
+uint16_t frameCRC16(const uint8_t *data,size_t len);
+size_t cobsEncode(const uint8_t *in,size_t len,uint8_t *out);
+size_t cobsDecode(const uint8_t *in,size_t len,uint8_t *out,size_t outMax);
+size_t frameEncode(const uint8_t *msg,size_t len,uint8_t *out);
+size_t frameDecode(const uint8_t *in,size_t len,uint8_t *msg);
+
+#endif
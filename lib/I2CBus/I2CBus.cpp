@@ -0,0 +1,153 @@
+/*
+This class owns the Wire instance and lets only one client use the bus at a time.
+every task that talks to any device on the bus does-
+	bus.acquire(myClient);
+	...one or few short transactions...
+	bus.release(myClient);
+
+waiting clients are served in order of their task priority (FreeRTOS mutex), not in order of arrival,
+so a task feeding RDS to QN8027 with highest priority always gets the bus next.
+mutex also has priority inheritance: while a high priority task waits, the low priority holder runs at its priority
+until it releases the bus, so holder cannot be stuck behind a medium priority task.
+so priority only works when nobody holds the bus long. big transfers (1 KB SSD1306 frame) must be split into
+small chunks with acquire()/release() around each chunk, then RDS can slip in between two chunks.
+
+for each client, time spent waiting for the bus (and how often it had to wait) and the longest hold are recorded.
+
+a slave reset or disturbed in the middle of a read keeps driving SDA low while it waits for SCL clocks that never come,
+then every transaction of every client times out. recover() frees it in well under a millisecond instead of a power cycle.
+*/
+
+#include <I2CBus.h>
+
+I2CBus::I2CBus(TwoWire &wire) : _wire(wire)
+{
+}
+
+/* starts Wire on given pins and creates the lock. call once from setup() before any client uses the bus. */
+void I2CBus::begin(int sda,int scl,uint32_t clockHz)
+{
+	if(_mutex == NULL) _mutex = xSemaphoreCreateMutex();
+	_sda = sda;
+	_scl = scl;
+	_wire.begin(sda,scl);
+	_wire.setClock(clockHz);
+	_wire.setTimeOut(I2CBUS_TIMEOUT_MS);
+}
+
+/* register a client, name is kept as pointer so it should be a string literal.
+	returns client id for acquire()/release(). when all I2CBUS_MAX_CLIENTS slots are used,
+	last slot is shared by rest of clients.
+*/
+uint8_t I2CBus::addClient(const char *name)
+{
+	if(_clientCount == I2CBUS_MAX_CLIENTS) return I2CBUS_MAX_CLIENTS - 1;
+	memset(&_clients[_clientCount],0,sizeof(I2CBusClient));
+	_clients[_clientCount].name = name;
+	return _clientCount++;
+}
+
+void I2CBus::acquire(uint8_t client)
+{
+	unsigned long startUs = micros();
+	bool contended = false;
+	if(_mutex != NULL && xSemaphoreTake(_mutex,0) != pdTRUE){
+		contended = true;
+		xSemaphoreTake(_mutex,portMAX_DELAY);
+	}
+	_acquiredUs = micros();
+	_holder = client;
+	if(client >= _clientCount) return;
+
+	I2CBusClient &c = _clients[client];
+	uint32_t waitUs = _acquiredUs - startUs;
+	c.acquisitions++;
+	if(contended) c.contended++;
+	c.lastWaitUs = waitUs;
+	c.totalWaitUs += waitUs;
+	if(waitUs > c.maxWaitUs) c.maxWaitUs = waitUs;
+}
+
+void I2CBus::release(uint8_t client)
+{
+	if(client < _clientCount){
+		uint32_t holdUs = micros() - _acquiredUs;
+		if(holdUs > _clients[client].maxHoldUs) _clients[client].maxHoldUs = holdUs;
+	}
+	_holder = I2CBUS_NO_CLIENT;
+	if(_mutex != NULL) xSemaphoreGive(_mutex);
+}
+
+/* Frees a bus whose SDA is held low by a slave. call it while holding the bus, after a transaction failed.
+	Wire lets go of the pins, SCL is clocked (at most I2CBUS_RECOVERY_CLOCKS times) until slave finishes its byte
+	and releases SDA, then a STOP puts every slave back to idle and Wire is started again with same clock and timeout.
+	returns true when SDA was low and is free now. when SDA is already high nothing is touched and it returns false,
+	so calling it after every kind of failure costs only one pin read.
+*/
+bool I2CBus::recover()
+{
+	if(_sda < 0 || _scl < 0 || digitalRead(_sda) == HIGH) return false;
+	uint32_t clockHz = _wire.getClock();
+	uint16_t timeOutMs = _wire.getTimeOut();
+	_wire.end();
+	pinMode(_sda,INPUT_PULLUP);
+	pinMode(_scl,OUTPUT_OPEN_DRAIN);
+	digitalWrite(_scl,HIGH);
+	for(uint8_t i = 0; i < I2CBUS_RECOVERY_CLOCKS && digitalRead(_sda) == LOW; i++){
+		digitalWrite(_scl,LOW);
+		delayMicroseconds(I2CBUS_RECOVERY_HALF_US);
+		digitalWrite(_scl,HIGH);
+		delayMicroseconds(I2CBUS_RECOVERY_HALF_US);
+	}
+	bool freed = digitalRead(_sda) == HIGH;
+	
+	//STOP: SDA goes high while SCL is high
+	pinMode(_sda,OUTPUT_OPEN_DRAIN);
+	digitalWrite(_scl,LOW);
+	digitalWrite(_sda,LOW);
+	delayMicroseconds(I2CBUS_RECOVERY_HALF_US);
+	digitalWrite(_scl,HIGH);
+	delayMicroseconds(I2CBUS_RECOVERY_HALF_US);
+	digitalWrite(_sda,HIGH);
+	delayMicroseconds(I2CBUS_RECOVERY_HALF_US);
+	
+	_wire.begin(_sda,_scl);
+	_wire.setClock(clockHz);
+	_wire.setTimeOut(timeOutMs);
+	if(freed){
+		recoveries++;
+	}else{
+		recoveryFailures++;
+	}
+	return freed;
+}
+
+TwoWire &I2CBus::wire()
+{
+	return _wire;
+}
+
+/* client holding the bus right now, I2CBUS_NO_CLIENT when free */
+uint8_t I2CBus::holder()
+{
+	return _holder;
+}
+
+uint8_t I2CBus::clientCount()
+{
+	return _clientCount;
+}
+
+const I2CBusClient &I2CBus::client(uint8_t id)
+{
+	return _clients[id < _clientCount ? id : 0];
+}
+
+void I2CBus::resetStats()
+{
+	for(uint8_t i = 0; i < _clientCount; i++){
+		const char *name = _clients[i].name;
+		memset(&_clients[i],0,sizeof(I2CBusClient));
+		_clients[i].name = name;
+	}
+}
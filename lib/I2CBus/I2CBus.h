@@ -0,0 +1,59 @@
+/* Arbiter for one I2C bus shared by several devices and tasks (QN8027, SSD1306 ...) */
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#ifndef I2CBus_h
+#define I2CBus_h
+
+#define 		I2CBUS_MAX_CLIENTS	  6
+#define 		I2CBUS_NO_CLIENT	  0xFF
+#define 		I2CBUS_TIMEOUT_MS	  20		//Wire gives up on a transaction after this, stuck bus included
+#define 		I2CBUS_RECOVERY_CLOCKS 9		//SCL pulses that finish any byte a slave is sending
+#define 		I2CBUS_RECOVERY_HALF_US 5		//half SCL period of recovery clocks, 100 kHz
+
+//wait and hold times of one client
+struct I2CBusClient
+{
+  const char *name;
+  uint32_t acquisitions;
+  uint32_t contended;			//times bus was busy and client had to wait
+  uint32_t lastWaitUs;
+  uint32_t maxWaitUs;
+  uint64_t totalWaitUs;			//divide by acquisitions for average
+  uint32_t maxHoldUs;			//longest time client kept the bus
+};
+
+class I2CBus
+{
+private:
+  TwoWire &_wire;
+  SemaphoreHandle_t _mutex = NULL;
+  I2CBusClient _clients[I2CBUS_MAX_CLIENTS];
+  uint8_t _clientCount = 0;
+  uint8_t _holder = I2CBUS_NO_CLIENT;
+  unsigned long _acquiredUs = 0;
+  int _sda = -1;
+  int _scl = -1;
+
+public:
+  uint32_t recoveries = 0;		//stuck SDA freed by recover()
+  uint32_t recoveryFailures = 0;	//SDA still low after recovery clocks
+
+  I2CBus(TwoWire &wire);
+  void begin(int sda,int scl,uint32_t clockHz);
+  uint8_t addClient(const char *name);
+  void acquire(uint8_t client);
+  void release(uint8_t client);
+  bool recover();
+
+  TwoWire &wire();
+  uint8_t holder();
+  uint8_t clientCount();
+  const I2CBusClient &client(uint8_t id);
+  void resetStats();
+};
+
+#endif
@@ -126,94 +126,472 @@ QN8027Radio::QN8027Radio()
   _address = QN8027_I2C_ADDR;
 }
 
+/* When Wire is shared with other devices or tasks, give a function which locks the bus.
+	it is called with true before and false after each transaction (one START..STOP),
+	never around two transactions, so a bus arbiter can put other transactions between RDS data and RDS toggle.
+	Example -
+	void radioBus(bool take){ if(take) bus.acquire(radioClient); else bus.release(radioClient); }
+	radio.setBusHook(radioBus);
+*/
+void QN8027Radio::setBusHook(QN8027BusHook hook)
+{
+	_busHook = hook;
+}
+
+/* Record every transaction (reads, writes and bursts) with its time and result into trace, NULL stops.
+	records are made while bus hook is held, so they come out in bus order even with several tasks.
+	see QN8027Trace.h for the format.
+*/
+void QN8027Radio::setTrace(QN8027Trace *trace)
+{
+	_trace = trace;
+}
+
 
 /* Set Transmitting Frequency From 76 to 108 MHz with decimal point
 	Example - setFrequency(88.1); , setFrequency(100);
+	ESP32-C3 has no FPU, so prefer setChannel() or setFrequencyKHz() which never touch float.
 */
 void QN8027Radio::setFrequency(float frequency)
 {
-  	uint16_t frequencyB = (frequency * 100 - 7600) / 5; 
+	setChannel((uint16_t)(frequency * 100 + 0.5f));
+}
+
+/* Set Transmitting Frequency in kHz. Example - setFrequencyKHz(88100); */
+bool QN8027Radio::setFrequencyKHz(uint32_t frequencyKHz)
+{
+	if(frequencyKHz > (uint32_t)QN8027_CHANNEL_MAX * 10) return false;
+	return setChannel((frequencyKHz + 5) / 10);
+}
+
+/* Set Transmitting Frequency in 10 kHz units, 7600 (76 MHz) to 10800 (108 MHz).
+	Example - setChannel(8810); for 88.1 MHz
+	chip tunes in 50 kHz steps, anything between is rounded to nearest step.
+	returns false (and writes nothing) when out of range.
+*/
+bool QN8027Radio::setChannel(uint16_t ch10kHz)
+{
+	if(ch10kHz < QN8027_CHANNEL_MIN || ch10kHz > QN8027_CHANNEL_MAX) return false;
+	uint16_t frequencyB = (ch10kHz - QN8027_CHANNEL_MIN + QN8027_CHANNEL_STEP / 2) / QN8027_CHANNEL_STEP;
 	uint8_t frequencyH = frequencyB >> 8;
-	freqH = frequencyH;
 	uint8_t frequencyL = frequencyB & 0XFF;
-	//freqL = frequencyL;
-	write1Byte(SYSTEM_REG,frequencyH);
-	write1Byte(CH1_REG,frequencyL);
+	bool sameChannel = frequencyH == freqH && frequencyL == freqL && (_knownRegs & (1UL << CH1_REG));
+	freqH = frequencyH;
+	freqL = frequencyL;
+	if(sameChannel){
+		autoFlush();	//nothing to retune, dont disturb the carrier
+		return true;
+	}
+	retune();
+	return true;
+}
+
+/* Writes SYSTEM_REG and CH1_REG together in one burst so that chip jumps to new channel in one step.
+	SYSTEM_REG keeps TX enable, mono, mute and RDS toggle bits, so carrier is not dropped while hopping.
+	time from this write until a STATUS_REG read shows Transmitting again is kept in retuneLatencyUs,
+	retuneDeadAir tells if chip left Transmitting state in between.
+*/
+void QN8027Radio::retune()
+{
+	stageReg(SYSTEM_REG,(radioStatus | monoAudio | muteAudio | rdsReady | freqH));
+	stageReg(CH1_REG,freqL);
+	_dirtyRegs |= (1UL << SYSTEM_REG) | (1UL << CH1_REG);	//even if SYSTEM_REG did not change
+	_retunePending = true;
+	autoFlush();
+}
+
+/* every STATUS_REG read comes here, it finishes retune latency measurement */
+void QN8027Radio::noteFSMStatus(uint8_t fsm)
+{
+	if(!_retuneMeasuring) return;
+	if(fsm != FSM_TRANSMITTING){
+		_retuneLeftTx = true;
+		return;
+	}
+	retuneLatencyUs = micros() - _retuneStartUs;
+	retuneDeadAir = _retuneLeftTx;
+	_retuneMeasuring = false;
 }
 
 /* Get Currently Transmitting Frequency with decimal point */
 float QN8027Radio::getFrequency()
 {
-	uint8_t frequencyH = read1Byte(SYSTEM_REG) & CH0_MASK;
-	uint8_t frequencyL = read1Byte(CH1_REG);
-	float freqCombine = (float)(((frequencyH<<8) | frequencyL)*5+7600)/100;
-	
-	return freqCombine;
+	return getChannel() / 100.0f;
+}
+
+/* Get Currently Transmitting Frequency in 10 kHz units (8810 == 88.1 MHz) */
+uint16_t QN8027Radio::getChannel()
+{
+	uint8_t chData[2] = {0, 0};
+	readBurst(SYSTEM_REG,chData,2);		//SYSTEM_REG and CH1_REG in one transfer
+	uint8_t frequencyH = chData[0] & CH0_MASK;
+	uint8_t frequencyL = chData[1];
+	return ((frequencyH<<8) | frequencyL) * QN8027_CHANNEL_STEP + QN8027_CHANNEL_MIN;
 }
 
-/* Read any Readable Register From QN8027 in 8bit integer. uses I2C protocol. */
+/* Read any Readable Register From QN8027 in 8bit integer. uses I2C protocol.
+	returns 0 when read failed, lastError tells which.
+*/
 uint8_t QN8027Radio::read1Byte(uint8_t regAddr)
 {
-	int8_t errorCode = 4;
-	
-	Wire.beginTransmission(QN8027_I2C_ADDR);
-	Wire.write(regAddr);
-	Wire.endTransmission();
-	Wire.requestFrom(QN8027_I2C_ADDR, 1);
-	errorCode = Wire.endTransmission();		//ACK read
-	
-	uint8_t readData = Wire.read();
-	
+	uint8_t readData = 0;
+	readBurst(regAddr,&readData,1);
 	return readData;
 }
 
+/* Read len registers starting from startReg in one I2C transaction.
+	register address is written without STOP, then a repeated START reads the data.
+	chip auto-increments register address after every byte just like writeBurst().
+	returns len, or 0 when read failed after all retries (data is then not valid).
+*/
+uint8_t QN8027Radio::readBurst(uint8_t startReg,uint8_t *data,uint8_t len)
+{
+	return transaction(startReg,true,data,len) ? len : 0;
+}
+
 /* Write any writable Register of QN8027
 	regAddr = Address of Register want to write.
 	comData = data you want to write in that register. comData means command Data.
+	returns false when chip did not take it after all retries.
+*/
+bool QN8027Radio::write1Byte(uint8_t regAddr,uint8_t comData)
+{
+	return transaction(regAddr,false,&comData,1);
+}
+
+/* Write len registers starting from startReg in one I2C transaction.
+	QN8027 auto-increments register address after every data byte, so this costs
+	one START, one address byte and one STOP no matter how many registers are written.
+	much cheaper than calling write1Byte() len times when OLED shares the same bus.
+*/
+bool QN8027Radio::writeBurst(uint8_t startReg,const uint8_t *data,uint8_t len)
+{
+	return transaction(startReg,false,(uint8_t *)data,len);	//data is only read on a write
+}
+
+//---------------------------Bus errors------------------------------------------------------
+/*
+every transaction goes through transaction(). a failed one (NACK, short read, driver timeout) is counted in
+i2cErrors and in regErrors[] of each register it touched, and made again after a backoff of QN8027_I2C_BACKOFF_US,
+doubled for every next retry. bus is released while waiting, so other clients are not stuck behind a sick chip.
+at most QN8027_I2C_RETRIES retries, and none starts later than QN8027_I2C_BUDGET_US after the first attempt,
+so a call ends within that budget plus one Wire timeout, landed or not. when it gives up, i2cFailures counts it.
+
+a failure other than NACK may be a slave holding SDA low (it was reset or glitched in the middle of a byte),
+then no transaction can get through until SCL is clocked. function given to setBusRecovery() is called right after
+such a failure while bus is still held, see I2CBus::recover().
+*/
+void QN8027Radio::setBusRecovery(QN8027BusRecovery recovery)
+{
+	_busRecovery = recovery;
+}
+
+/* retries == 0 gives up on first failure */
+void QN8027Radio::setRetryPolicy(uint8_t retries,uint32_t budgetUs)
+{
+	_retries = retries;
+	_budgetUs = budgetUs;
+}
+
+void QN8027Radio::clearErrorCounts()
+{
+	lastError = 0;
+	i2cErrors = 0;
+	i2cRetries = 0;
+	i2cFailures = 0;
+	busRecoveries = 0;
+	memset(regErrors,0,sizeof(regErrors));
+}
+
+void QN8027Radio::backoff(uint32_t us)
+{
+	if(us >= 1000){
+		delay(us / 1000);			//lets other tasks run
+	}else{
+		delayMicroseconds(us);
+	}
+}
+
+bool QN8027Radio::transaction(uint8_t reg,bool read,uint8_t *data,uint8_t len)
+{
+	unsigned long firstUs = micros();
+	uint32_t backoffUs = QN8027_I2C_BACKOFF_US;
+	for(uint8_t attempt = 0; ; attempt++){
+		uint8_t result;
+		if(_busHook) _busHook(true);
+		unsigned long startUs = micros();
+		Wire.beginTransmission(_address);
+		Wire.write(reg);
+		if(read){
+			result = Wire.endTransmission(false);	//no STOP, keep the bus for repeated START
+			uint8_t received = Wire.requestFrom(_address,len);
+			for(uint8_t i = 0; i < received; i++){
+				data[i] = Wire.read();
+			}
+			if(result == 0 && received < len) result = QN8027_TRACE_SHORT_READ;
+		}else{
+			Wire.write(data,len);
+			result = Wire.endTransmission();		//ACK read
+		}
+		if(_trace) _trace->record(_address,reg,read,data,len,result,startUs);	//bytes not received are as caller left them
+		if(result != 0 && result != QN8027_I2C_NACK_ADDR && result != QN8027_I2C_NACK_DATA && _busRecovery != NULL){
+			if(_busRecovery()) busRecoveries++;
+		}
+		if(_busHook) _busHook(false);
+		
+		lastError = result;
+		if(result == 0) return true;
+		i2cErrors++;
+		for(uint8_t i = 0; i < len && reg + i < QN8027_REG_COUNT; i++){
+			if(regErrors[reg + i] < 0xFFFF) regErrors[reg + i]++;
+		}
+		if(attempt >= _retries || micros() - firstUs + backoffUs > _budgetUs){
+			i2cFailures++;
+			return false;
+		}
+		i2cRetries++;
+		backoff(backoffUs);
+		backoffUs *= 2;
+	}
+}
+
+//---------------------------Shadow registers------------------------------------------------
+/*
+This class keeps a copy(shadow) of registers 0x00 to 0x12 which setters change instead of chip,
+and a second copy of what chip really holds. a register is dirty when these two are diffrent,
+flush() then sends only dirty registers. so calling setTxPower(75) ten times costs one I2C write, not ten.
+what chip holds is "unknown" until register is written once, and becomes unknown again after reset().
 */
-void QN8027Radio::write1Byte(uint8_t regAddr,uint8_t comData)
+
+/* put value in shadow of register reg. marks it dirty only if chip does not already have this value. */
+void QN8027Radio::stageReg(uint8_t regAddr,uint8_t value)
 {
-	int8_t errorCode = 4;
+	uint32_t regBit = 1UL << regAddr;
+	_shadow[regAddr] = value;
+	if((_knownRegs & regBit) && _chipRegs[regAddr] == value){
+		_dirtyRegs &= ~regBit;
+	}else{
+		_dirtyRegs |= regBit;
+	}
+}
+
+void QN8027Radio::autoFlush()
+{
+	if(!_holdWrites) flush();
+}
+
+/* Write all dirty registers to chip.
+	neighbouring dirty registers are merged into one burst. a gap of up to QN8027_BURST_MAX_GAP clean registers
+	is also bridged (rewriting their shadow value) because one extra byte is cheaper than a new START+address+STOP.
+	bursts never cross read only registers (CID1, CID2, STATUS).
+	returns false when a burst failed, it and all bursts after it stay dirty for next flush().
+*/
+bool QN8027Radio::flush()
+{
+	uint8_t reg = 0;
+	while(reg < QN8027_REG_COUNT){
+		if(!(_dirtyRegs & (1UL << reg))){
+			reg++;
+			continue;
+		}
+		uint8_t last = reg;
+		for(uint8_t next = reg + 1; next < QN8027_REG_COUNT && next - last <= QN8027_BURST_MAX_GAP + 1; next++){
+			uint32_t nextBit = 1UL << next;
+			if(!(QN8027_WRITABLE_REGS & nextBit)) break;
+			if(_dirtyRegs & nextBit){
+				last = next;
+			}else if(!(_knownRegs & nextBit)){
+				break;		//cannot rewrite a register we dont know value of
+			}
+		}
+		if(!writeRegs(reg,&_shadow[reg],last - reg + 1)) return false;
+		reg = last + 1;
+	}
+	return true;
+}
+
+/* true when a setting register failed to write and waits for next flush() */
+bool QN8027Radio::writesPending()
+{
+	return !_holdWrites && (_dirtyRegs & QN8027_CONFIG_REGS);
+}
+
+/* Write every writable setting register from the variables of this class, changed or not.
+	SYSTEM_REG to VGA_REG goes in one burst and PAC_REG to RDS_REG in another.
+	(CID and STATUS registers sits between them and are read only, RDSD registers are left alone)
+*/
+bool QN8027Radio::updateAllRegs()
+{
+	stageReg(SYSTEM_REG,(radioStatus | monoAudio | muteAudio | rdsReady | freqH));
+	stageReg(CH1_REG,freqL);
+	stageReg(GPLT_REG,(preEmphTime | privateMode | PAAutoOffTime | TxPilotFreqDeviation));
+	stageReg(XTL_REG,(clockSource | CrystalCurrentuA));
+	stageReg(VGA_REG,(crystalFreqMHz | TxInputBufferGain | TxDigitalGain | LRInputImpdKOhm));
+	stageReg(PAC_REG,(AudioPeakClear | PAOutputPower));
+	stageReg(FDEV_REG,TxFreqDeviation);
+	stageReg(RDS_REG,(RDSEnable | RDSFreqDeviationKHz));
+	_dirtyRegs |= QN8027_CONFIG_REGS;		//write them even if chip already has same values
+	return flush();
+}
+
+/* Register image for fast boot.
+	getRegImage() fills QN8027_REG_COUNT bytes (SYSTEM_REG..RDS_REG) with what setters want in each register,
+	read only and RDS data registers are left 0 and SYSTEM_REG never has reset, recalibrate or RDS toggle bits.
+	save it as one blob (Preferences::putBytes()) and after next power on-
+	radio.reset();
+	radio.reCalibrate();
+	radio.loadRegImage(image);	//every setting in two bursts, carrier is on before anything else starts
+	loadRegImage() also puts values back into variables of this class, so later setters change only their own bits.
+	returns false (and writes nothing) when image does not look like one made by getRegImage().
+*/
+void QN8027Radio::getRegImage(uint8_t *image)
+{
+	memset(image,0,QN8027_REG_COUNT);
+	image[SYSTEM_REG] = radioStatus | monoAudio | muteAudio | freqH;
+	image[CH1_REG] = freqL;
+	image[GPLT_REG] = preEmphTime | privateMode | PAAutoOffTime | TxPilotFreqDeviation;
+	image[XTL_REG] = clockSource | CrystalCurrentuA;
+	image[VGA_REG] = crystalFreqMHz | TxInputBufferGain | TxDigitalGain | LRInputImpdKOhm;
+	image[PAC_REG] = PAOutputPower;
+	image[FDEV_REG] = _agcOn ? _nominalFdev : TxFreqDeviation;		//not what limiter has right now
+	image[RDS_REG] = RDSEnable | RDSFreqDeviationKHz;
+}
+
+bool QN8027Radio::loadRegImage(const uint8_t *image)
+{
+	uint16_t channel = ((image[SYSTEM_REG] & CH0_MASK) << 8) | image[CH1_REG];
+	if(image[SYSTEM_REG] & 0xC4) return false;			//reset, recalibrate or RDS toggle bit set
+	if(channel > (QN8027_CHANNEL_MAX - QN8027_CHANNEL_MIN) / QN8027_CHANNEL_STEP) return false;
+	
+	radioStatus = image[SYSTEM_REG] & 32;
+	monoAudio = image[SYSTEM_REG] & 16;
+	muteAudio = image[SYSTEM_REG] & 8;
+	freqH = image[SYSTEM_REG] & CH0_MASK;
+	freqL = image[CH1_REG];
+	preEmphTime = image[GPLT_REG] & 128;
+	privateMode = image[GPLT_REG] & 64;
+	PAAutoOffTime = image[GPLT_REG] & 48;
+	TxPilotFreqDeviation = image[GPLT_REG] & 15;
+	clockSource = image[XTL_REG] & 0xC0;
+	CrystalCurrentuA = image[XTL_REG] & 0x3F;
+	crystalFreqMHz = image[VGA_REG] & 128;
+	TxInputBufferGain = image[VGA_REG] & 0x70;
+	TxDigitalGain = image[VGA_REG] & 0x0C;
+	LRInputImpdKOhm = image[VGA_REG] & 3;
+	PAOutputPower = image[PAC_REG] & 127;
+	TxFreqDeviation = image[FDEV_REG];
+	_nominalFdev = TxFreqDeviation;
+	RDSEnable = image[RDS_REG] & 128;
+	RDSFreqDeviationKHz = image[RDS_REG] & 127;
 	
-	Wire.beginTransmission(QN8027_I2C_ADDR);
-	Wire.write(regAddr);
-	Wire.write(comData);
-	errorCode = Wire.endTransmission();		//ACK read
+	_retunePending = true;		//measure how long chip takes to get on air
+	updateAllRegs();
+	return true;
+}
+
+/* Hold all setter writes until endUpdate() is called.
+	use it when changing many settings at once, for example-
+	radio.beginUpdate();
+	radio.setFrequency(88.1);
+	radio.setTxPower(75);
+	radio.MonoAudio(ON);
+	radio.endUpdate();		//only registers that really changed are written, in as few bursts as possible
+*/
+void QN8027Radio::beginUpdate()
+{
+	_holdWrites = true;
+}
+
+bool QN8027Radio::endUpdate()
+{
+	_holdWrites = false;
+	return flush();
 }
+
+/* Write len registers and keep shadow in sync. used for registers that must go out right now
+	(RDS data and toggle) even inside beginUpdate()/endUpdate(), and for raw register writes from outside.
+	setter fields (PAOutputPower etc.) are not decoded back, next setter of same register rebuilds it from them.
+	when write fails, chip may hold any part of it, so registers become unknown and setting registers stay dirty.
+*/
+bool QN8027Radio::writeRegs(uint8_t startReg,const uint8_t *data,uint8_t len)
+{
+	bool landed = writeBurst(startReg,data,len);
+	for(uint8_t i = 0; i < len; i++){
+		uint32_t regBit = 1UL << (startReg + i);
+		_shadow[startReg + i] = data[i];
+		if(landed){
+			_chipRegs[startReg + i] = data[i];
+			_knownRegs |= regBit;
+			_dirtyRegs &= ~regBit;
+		}else{
+			_knownRegs &= ~regBit;
+			_dirtyRegs |= regBit & QN8027_CONFIG_REGS;	//RDS data is pushed again by RDS engine, not by flush()
+		}
+	}
+	if(!landed) return false;
+	if(_retunePending && startReg <= CH1_REG && startReg + len > CH1_REG){
+		_retunePending = false;
+		_retuneMeasuring = true;
+		_retuneLeftTx = false;
+		_retuneStartUs = micros();
+	}
+	return true;
+}
+
 /* base Function For RDS data sending.
+	blocking style: call waitForRDSSend() after it before sending next group.
+	for sending without blocking use queueRDS() and pollRDS() instead.
 */
 void QN8027Radio::sendRDS(char By0,char By1,char By2,char By3,char By4,char By5,char By6,char By7){
-	rdsSentStatus = read1Byte(STATUS_REG) & 8;
-	write1Byte(RDSD0_REG,By0);
-	write1Byte(RDSD1_REG,By1);
-	write1Byte(RDSD2_REG,By2);
-	write1Byte(RDSD3_REG,By3);
-	write1Byte(RDSD4_REG,By4);
-	write1Byte(RDSD5_REG,By5);
-	write1Byte(RDSD6_REG,By6);
-	write1Byte(RDSD7_REG,By7);
+	uint8_t status;
+	if(readBurst(STATUS_REG,&status,1)) rdsSentStatus = status & 8;
+	uint8_t group[8] = {(uint8_t)By0,(uint8_t)By1,(uint8_t)By2,(uint8_t)By3,(uint8_t)By4,(uint8_t)By5,(uint8_t)By6,(uint8_t)By7};
+	pushRDSGroup(group);
+}
+
+/* all 8 RDS bytes are written in one burst, then SYSTEM_REG toggles rdsReady to tell chip that new group is ready.
+	when data did not land there is no toggle, chip would send half old half new group. RDS timeout pushes it again.
+	toggle carries channel bits of SYSTEM_REG, so it must never put new bits next to old CH1_REG: when a retune
+	is not on chip yet (failed or held by beginUpdate()) or SYSTEM_REG is unknown, toggle goes out in one burst
+	with CH1_REG, like retune(). otherwise only RDSRDY of what chip already has is flipped.
+*/
+void QN8027Radio::pushRDSGroup(const uint8_t *group){
+	_rdsPushedAt = millis();
+	if(!writeRegs(RDSD0_REG,group,8)) return;
 	if(rdsReady==4){
 		rdsReady = 0;
 	}else{
 		rdsReady = 4;
 	}
-	updateSYSTEM_REG();
+	if((_dirtyRegs & ((1UL << SYSTEM_REG) | (1UL << CH1_REG))) || !(_knownRegs & (1UL << SYSTEM_REG))){
+		uint8_t regs[2] = {(uint8_t)(radioStatus | monoAudio | muteAudio | rdsReady | freqH),freqL};
+		writeRegs(SYSTEM_REG,regs,2);	//not held by beginUpdate(), a failed burst stays dirty for next flush()
+	}else{
+		uint8_t sysReg = (_chipRegs[SYSTEM_REG] & ~4) | rdsReady;
+		writeRegs(SYSTEM_REG,&sysReg,1);
+	}
+	_rdsPushedAt = millis();
+	planRDSRead();
 }
 //---------------------------SYSTEM_REG------------------------------------------------------------
 /*
 Resets all registers(settings) to default.
 */
 void QN8027Radio::updateSYSTEM_REG(){
-	write1Byte(SYSTEM_REG,(radioStatus | monoAudio | muteAudio | rdsReady | freqH));
+	stageReg(SYSTEM_REG,(radioStatus | monoAudio | muteAudio | rdsReady | freqH));
+	autoFlush();
 }
 void QN8027Radio::reset()
 {
 	write1Byte(SYSTEM_REG,0x80);
+	_knownRegs = 0;		//chip is back to its defaults, shadow is not valid anymore
+	_dirtyRegs = 0;
 }
 
 /* Recalibrates internal RF power amplifier for load antenna attached. this process is automatic and you just need to use this function only.*/
 void QN8027Radio::reCalibrate(){
 	write1Byte(SYSTEM_REG,0x40);
+	_knownRegs &= ~(1UL << SYSTEM_REG);
 }
 
 /*mutes audio to transmitter output. transmitter will only transmite carrier frequency without audio.
@@ -255,7 +633,8 @@ void QN8027Radio::Switch(uint8_t onOffCtrl)
 
 //---------------------------GPLT_REG----------------------------------------------------------
 void QN8027Radio::updateGPLT_REG(){
-	write1Byte(GPLT_REG,(preEmphTime | privateMode | PAAutoOffTime | TxPilotFreqDeviation));
+	stageReg(GPLT_REG,(preEmphTime | privateMode | PAAutoOffTime | TxPilotFreqDeviation));
+	autoFlush();
 }
 // I really dont know why is this option there. it gave mono audio with narrow CarrierWave bandwidth in my tests.
 // you can provide ON or OFF in parameter to this function.
@@ -312,7 +691,8 @@ void QN8027Radio::radioNoAudioAutoOFF(uint8_t onOffCtrl){
 
 //------------------------XTL_REG-------------------------------------------------------------
 void QN8027Radio::updateXTL_REG(){
-	write1Byte(XTL_REG,(clockSource | CrystalCurrentuA));
+	stageReg(XTL_REG,(clockSource | CrystalCurrentuA));
+	autoFlush();
 }
 /*
 Type::meaning
@@ -341,7 +721,8 @@ void QN8027Radio::setCrystalCurrent(float percentOfMax){  //current between 0 to
 
 //-----------------------VGA_REG--------------------------------------------------------------
 void QN8027Radio::updateVGA_REG(){
-	write1Byte(VGA_REG,(crystalFreqMHz | TxInputBufferGain | TxDigitalGain | LRInputImpdKOhm));
+	stageReg(VGA_REG,(crystalFreqMHz | TxInputBufferGain | TxDigitalGain | LRInputImpdKOhm));
+	autoFlush();
 }
 
 /* 
@@ -411,10 +792,20 @@ Fdev values can be set from 0 to 255.
 default is 129 which means 74.82 KHz
 maximum bandwidth can be 148 KHz by setting Fdev value to 255
 */
+void QN8027Radio::updateFDEV_REG(){
+	stageReg(FDEV_REG,TxFreqDeviation);
+	autoFlush();
+}
 void QN8027Radio::setTxFreqDeviation(uint8_t Fdev){
-	write1Byte(FDEV_REG,Fdev);
+	TxFreqDeviation = Fdev;
+	_nominalFdev = Fdev;
+	updateFDEV_REG();
 }
 //---------------------------RDS_REG-------------------------------------------------------
+void QN8027Radio::updateRDS_REG(){
+	stageReg(RDS_REG,(RDSEnable | RDSFreqDeviationKHz));
+	autoFlush();
+}
 /* set RDS channel ON or OFF */
 void QN8027Radio::RDS(uint8_t onOffCtrl){
 	if(onOffCtrl==ON){
@@ -422,7 +813,7 @@ void QN8027Radio::RDS(uint8_t onOffCtrl){
 	}else{
 		RDSEnable = 0;
 	}
-	write1Byte(RDS_REG,(RDSEnable | RDSFreqDeviationKHz));
+	updateRDS_REG();
 }
 /* set bandwidth of RDS channel.
 actual bandwidth in KHz = RDSFreqDev * 0.35
@@ -432,10 +823,14 @@ maximum bandwidth can be 44.45 KHz by setting RDSFreqDev value to 127
 */
 void QN8027Radio::setRDSFreqDeviation(uint8_t RDSFreqDev){
 	RDSFreqDeviationKHz = RDSFreqDev;
-	write1Byte(RDS_REG,(RDSEnable | RDSFreqDeviationKHz));
+	updateRDS_REG();
 }
 
 //--------------------------PAC_REG---------------------------------------------------------
+void QN8027Radio::updatePAC_REG(){
+	stageReg(PAC_REG,(AudioPeakClear | PAOutputPower));
+	autoFlush();
+}
 /*
 this chip has a clever feature of audio peak detection. which can be used as silence detection or automatic audio Gain control.
 it can also be used as drawing input audio graph.
@@ -453,7 +848,7 @@ void QN8027Radio::clearAudioPeak(){
 	}else{
 		AudioPeakClear = 128;
 	}
-	write1Byte(PAC_REG,(AudioPeakClear | PAOutputPower));	
+	updatePAC_REG();
 }
 /*
 sets power of internal RF Power Amplifier.
@@ -467,7 +862,7 @@ althogh setX is 7 bit long, which means you can set values from 0 to 127. but th
 void QN8027Radio::setTxPower(uint8_t setX) 
 {
 	PAOutputPower = setX;
-	write1Byte(PAC_REG,(AudioPeakClear | PAOutputPower));
+	updatePAC_REG();
 }
 
 //----------------------STATUS_REG ----------------------------------------------------------
@@ -483,65 +878,465 @@ value::Meaning
 6   :: PA is OFF
 */
 uint8_t QN8027Radio::getFSMStatus(){
-	uint8_t tmp = read1Byte(STATUS_REG);
-	return (tmp & 7);
+	return poll().fsm;
 }
-/* get maximum amplitude of input audio since last reading
+/* get maximum amplitude of input audio since last clearing
 multiply this value by 45 and you will get amplitude in mili Volts.
+peak is cleared only as peakClearPolicy says, or by calling clearAudioPeak() yourself.
 */
 uint8_t QN8027Radio::getAudioInpPeak(){
-	uint8_t tmp = read1Byte(STATUS_REG);
-	clearAudioPeak();
-	return (tmp >> 4);
+	return poll().audioPeak;
+}
+/* Reads SYSTEM_REG to STATUS_REG in one transfer.
+	returns STATUS_REG (same as getStatus())
+	and puts current frequency in 10 kHz units (same as getChannel()) into *channel when it is not NULL.
+	when read fails it returns 0 and leaves *channel as it was.
+*/
+uint8_t QN8027Radio::readStatus(uint16_t *channel){
+	uint8_t regs[STATUS_REG + 1];
+	if(!readBurst(SYSTEM_REG,regs,sizeof(regs))) return 0;
+	noteFSMStatus(regs[STATUS_REG] & 7);
+	if(channel != NULL){
+		*channel = (((regs[SYSTEM_REG] & CH0_MASK) << 8) | regs[CH1_REG]) * QN8027_CHANNEL_STEP + QN8027_CHANNEL_MIN;
+	}
+	return regs[STATUS_REG];
 }
 uint8_t QN8027Radio::getStatus(){
-	uint8_t tmp = read1Byte(STATUS_REG);
-	clearAudioPeak();
-	return tmp;
+	return poll().raw;
+}
+
+/* One STATUS_REG read decoded into FSM state, RDS toggle and audio peak together.
+	call it at your own rate (display, FSM change detection, telemetry) and use the snapshot for all of them,
+	last one is also kept in lastStatus. it feeds RDS engine with same read, so it never costs RDS an extra read.
+	
+	it writes nothing unless peakClearPolicy is PEAK_CLEAR_ON_POLL, then it clears audio peak after reading
+	so each snapshot has peak since previous one. with PEAK_CLEAR_MANUAL (default) call clearAudioPeak() yourself.
+*/
+StatusSnapshot QN8027Radio::poll(){
+	if(!readSnapshot(false)) return lastStatus;		//read failed, lastStatus is still previous one
+	if(_agcOn) agcStep(lastStatus.audioPeak);
+	if(peakClearPolicy == PEAK_CLEAR_ON_POLL) clearAudioPeak();
+	return lastStatus;
+}
+
+void QN8027Radio::setPeakClearPolicy(uint8_t policy){
+	peakClearPolicy = policy;
+}
+
+//-------------------Audio level control------------------------------------------------------
+/*
+Closed loop input gain control and deviation limiter. phone line outs and mixers need very diffrent gain,
+with this ON it is found automatically from audio peak in STATUS_REG.
+it runs inside poll(), so call poll() regularly (every 20-100ms) with setPeakClearPolicy(PEAK_CLEAR_ON_POLL),
+then every peak is peak since previous poll().
+
+attack : peak reaches AGC_PEAK_HIGH -> input buffer gain one step (3 dB) down, at most once per AGC_ATTACK_MS.
+release: peak stays below AGC_PEAK_LOW for AGC_RELEASE_MS -> gain one step up.
+between these two nothing changes (hysteresis). one 3 dB step up from AGC_PEAK_LOW stays under AGC_PEAK_HIGH,
+so loop does not hunt between two steps.
+limiter: when estimated deviation (see estimatedDeviation10Hz()) is over 75 kHz and gain cannot go down (or is not reason),
+deviation (FDEV_REG) is stepped down by AGC_FDEV_STEP. on release it goes back towards value of setTxFreqDeviation(),
+never above it, and only as far as AGC_PEAK_HIGH still stays under limit.
+only input buffer gain is used, digital gain and input impedence stay where you put them.
+agcAdjustments counts steps made, agcOverLimitMs time spent over the limit.
+*/
+void QN8027Radio::setAGC(uint8_t onOffCtrl){
+	if(onOffCtrl == ON){
+		_agcOn = true;
+		_agcLastChange = millis();
+		_agcLowSince = millis();
+		_agcLastSample = millis();
+	}else{
+		if(_agcOn && TxFreqDeviation != _nominalFdev){
+			TxFreqDeviation = _nominalFdev;		//give back full deviation
+			updateFDEV_REG();
+		}
+		_agcOn = false;
+	}
+}
+
+/* deviation audio with this peak (0-15) causes at current FDEV_REG, in 10 Hz units (7500 == 75 kHz).
+	peak 15 is taken as full scale, so this is estimate, not measurement.
+*/
+uint16_t QN8027Radio::estimatedDeviation10Hz(uint8_t peak){
+	return (uint32_t)peak * TxFreqDeviation * 58 / 15;
+}
+
+void QN8027Radio::agcStep(uint8_t peak){
+	unsigned long now = millis();
+	bool overLimit = estimatedDeviation10Hz(peak) > AGC_MAX_DEV_10HZ;
+	if(overLimit) agcOverLimitMs += now - _agcLastSample;
+	_agcLastSample = now;
+	
+	uint8_t ibGain = TxInputBufferGain >> 4;
+	if(peak >= AGC_PEAK_HIGH || overLimit){				//attack
+		_agcLowSince = now;
+		if(now - _agcLastChange < AGC_ATTACK_MS) return;
+		if(peak >= AGC_PEAK_HIGH && ibGain > 0){
+			TxInputBufferGain = (ibGain - 1) << 4;
+			updateVGA_REG();
+		}else if(overLimit && TxFreqDeviation > AGC_FDEV_STEP){
+			TxFreqDeviation -= AGC_FDEV_STEP;
+			updateFDEV_REG();
+		}else{
+			return;
+		}
+	}else if(peak >= AGC_PEAK_LOW){
+		_agcLowSince = now;								//inside target band
+		return;
+	}else{												//release
+		if(now - _agcLowSince < AGC_RELEASE_MS) return;
+		_agcLowSince = now;
+		uint16_t nextFdev = TxFreqDeviation + AGC_FDEV_STEP;
+		if(nextFdev > _nominalFdev) nextFdev = _nominalFdev;
+		if(TxFreqDeviation < _nominalFdev && (uint32_t)(AGC_PEAK_HIGH - 1) * nextFdev * 58 / 15 <= AGC_MAX_DEV_10HZ){
+			TxFreqDeviation = nextFdev;
+			updateFDEV_REG();
+		}else if(ibGain < AGC_MAX_IBGAIN){
+			TxInputBufferGain = (ibGain + 1) << 4;
+			updateVGA_REG();
+		}else{
+			return;
+		}
+	}
+	agcAdjustments++;
+	_agcLastChange = now;
 }
 
 //-------------------RDS sending---------------------------------------------------------------
+/*
+Non blocking RDS sending.
+queueRDS() puts a group in a ring buffer of RDS_QUEUE_LEN groups and returns immediately.
+pollRDS() must be called often (every 10ms or so) from loop(). each call it reads STATUS_REG once,
+and when chip has toggled rdsSentStatus (means it has taken previous group) it pushes next group.
+it never waits or sleeps. when chip does not take a group in RDS_TIMEOUT_MS, group is pushed again
+up to RDS_MAX_RETRIES times and then dropped, so a chip which never toggles cannot hang the firmware.
+pollRDS() does no I2C at all when nothing is queued or in flight. poll() (status snapshot) also drives
+RDS engine with its read, so both can be used together.
+
+station name (0A groups) and radio text (2A groups) are not queued, they are encoded once by
+sendStationName()/sendRadioText() and pollRDS() walks over them in place.
+setRDSMix(N) asks for N station name groups every second, whenever one of them is due it goes before
+anything else. free slots go to queue first (other groups), then to radio text, and when there is nothing
+else station name fills them too, so receivers get PS as often as possible and lock quickly.
+
+counters rdsGroupsSent, rdsTimeouts, rdsRetries and rdsDropped tell how it is going,
+rdsLateGroups counts station name groups sent more than one group time after they were due,
+rdsQueuePeak is highest queue depth seen and rdsQueueOverflows counts groups refused by a full queue.
+*/
+bool QN8027Radio::queueRDS(const uint8_t *group){
+	if(_rdsCount >= RDS_QUEUE_LEN){
+		rdsQueueOverflows++;
+		return false;
+	}
+	uint8_t tail = (_rdsHead + _rdsCount) % RDS_QUEUE_LEN;
+	memcpy(_rdsQueue[tail],group,8);
+	_rdsCount++;
+	if(_rdsCount > rdsQueuePeak) rdsQueuePeak = _rdsCount;
+	return true;
+}
+
+/* psPerSecond = how many station name (0A) groups to send every second. 0 = only when queue is empty.
+	chip can send about 11.4 groups in a second. default is RDS_DEFAULT_PS_PER_SEC.
+*/
+void QN8027Radio::setRDSMix(uint8_t psPerSecond){
+	_psIntervalMs = psPerSecond ? 1000 / psPerSecond : 0;
+	_psDueAt = millis();
+}
+
+/* picks next group to send: due station name first, then queue, then radio text, then station name as filler.
+	returns pointer to the group where it already lives, queue slot is freed only after chip has taken it.
+*/
+const uint8_t *QN8027Radio::nextRDSGroup(){
+	unsigned long now = millis();
+	bool psDue = _psCount && _psIntervalMs && (long)(now - _psDueAt) >= 0;
+	const uint8_t *group;
+	
+	_rdsFromQueue = false;
+	if(psDue){
+		if(now - _psDueAt > RDS_GROUP_MS) rdsLateGroups++;
+		_psDueAt += _psIntervalMs;
+		if((long)(now - _psDueAt) >= 0) _psDueAt = now + _psIntervalMs;	//too far behind, start again from now
+	}else if(_rdsCount){
+		_rdsFromQueue = true;
+		return _rdsQueue[_rdsHead];
+	}else if(_rtCount){
+		group = _rtGroups[_rtIndex];
+		_rtIndex = (_rtIndex + 1) % _rtCount;
+		return group;
+	}else if(!_psCount){
+		return NULL;
+	}
+	group = _psGroups[_psIndex];
+	_psIndex = (_psIndex + 1) % _psCount;
+	return group;
+}
+
+/* chip has taken (or we gave up on) group in flight */
+void QN8027Radio::rdsGroupDone(){
+	_rdsInFlight = false;
+	if(_rdsFromQueue && _rdsCount){
+		_rdsHead = (_rdsHead + 1) % RDS_QUEUE_LEN;
+		_rdsCount--;
+	}
+	_rdsFromQueue = false;
+}
+
+/* number of groups waiting in queue (group in flight not counted) */
+uint8_t QN8027Radio::rdsQueueDepth(){
+	return (_rdsInFlight && _rdsFromQueue) ? _rdsCount - 1 : _rdsCount;
+}
+
+/* true when there is nothing to send and chip has taken last group */
+bool QN8027Radio::rdsIdle(){
+	return _rdsCount == 0 && _psCount == 0 && _rtCount == 0 && !_rdsInFlight;
+}
+
+/* drop everything waiting in queue, station name and radio text. group already in chip will still be sent. */
+void QN8027Radio::clearRDSQueue(){
+	_rdsCount = 0;
+	_psCount = 0;
+	_rtCount = 0;
+	_rtLen = 0;
+	_rdsInFlight = false;
+	_rdsFromQueue = false;
+}
+
+/* RDS engine part of a STATUS_REG read. rdsRead == true when read was made for RDS (pollRDS()). */
+void QN8027Radio::serviceRDS(uint8_t status,unsigned long nowUs,bool rdsRead){
+	status &= 8;
+	if(_rdsInFlight){
+		if(rdsRead) _rdsGroupPolls++;
+		if(status != rdsSentStatus){		//chip has taken the group
+			rdsSentStatus = status;
+			rdsGroupDone();
+			rdsGroupsSent++;
+			rdsToggleSeen(nowUs);
+		}else if(millis() - _rdsPushedAt >= RDS_TIMEOUT_MS){
+			rdsTimeouts++;
+			if(_rdsTries < RDS_MAX_RETRIES){
+				_rdsTries++;
+				rdsRetries++;
+				pushRDSGroup(_rdsGroupPtr);
+				return;
+			}
+			rdsDropped++;
+			rdsGroupDone();
+		}else{
+			rdsNoToggle(nowUs);
+			return;						//still sending, check again next poll
+		}
+	}
+	_rdsLastReadUs = nowUs;
+	
+	_rdsGroupPtr = nextRDSGroup();
+	if(_rdsGroupPtr == NULL) return;
+	rdsSentStatus = status;
+	_rdsTries = 0;
+	_rdsInFlight = true;
+	pushRDSGroup(_rdsGroupPtr);
+}
+
+/* reads STATUS_REG once and gives it to everyone who needs it: RDS engine, retune measurement, lastStatus */
+bool QN8027Radio::readSnapshot(bool rdsRead){
+	StatusSnapshot snap;
+	if(!readBurst(STATUS_REG,&snap.raw,1)) return false;
+	snap.fsm = snap.raw & 7;
+	snap.rdsToggle = snap.raw & 8;
+	snap.audioPeak = snap.raw >> 4;
+	snap.timeMs = millis();
+	
+	noteFSMStatus(snap.fsm);
+	if(!rdsIdle()) serviceRDS(snap.raw,micros(),rdsRead);
+	lastStatus = snap;
+	return true;
+}
+
+/* RDS only poll. call it as often as you like (every 10ms or when timer from rdsWakeDelayUs() fires),
+	it reads STATUS_REG only when RDS engine needs it. returns true when it did read.
+*/
+bool QN8027Radio::pollRDS(){
+	if(rdsIdle() || !rdsDue()) return false;	//nothing to send or prediction says chip is still sending
+	readSnapshot(true);
+	return true;
+}
+
+/*
+RDS cadence prediction.
+chip takes a new group only at the end of group it is sending, so toggles of rdsSentStatus come
+every ~87.6ms (RDS_GROUP_US) when chip is kept busy. polling STATUS_REG every 10ms wastes ~8 reads per group.
+with setRDSPrediction(ON), pollRDS() learns real group period from toggle times and reads STATUS_REG only twice per group:
+once RDS_WAKE_EARLY_US before expected toggle and once same time after it. toggle time is taken as middle of the last
+read without toggle and first read with it, so prediction does not drift.
+if second read still shows no toggle, prediction has missed (rdsPredictMisses) and pollRDS() reads every
+RDS_WAKE_EARLY_US until toggle is seen again, which also finds the toggle time again precisely enough.
+rdsWakeDelayUs() tells how long caller can sleep before next pollRDS() will touch the bus, use it to arm a timer.
+rdsLastGroupPolls, rdsMaxGroupPolls and rdsGroupPolls (total) tell how many pollRDS() reads each group cost.
+*/
+void QN8027Radio::setRDSPrediction(uint8_t onOffCtrl){
+	rdsPrediction = onOffCtrl;
+	_rdsPredictMiss = true;		//start with plain polling until a toggle is seen
+	_rdsToggleValid = false;
+}
+
+/* true when next pollRDS() will read STATUS_REG */
+bool QN8027Radio::rdsDue(){
+	if(!_rdsInFlight) return !rdsIdle();
+	if(rdsPrediction == OFF) return true;
+	if(_rdsPredictMiss) return micros() - _rdsLastReadUs >= RDS_WAKE_EARLY_US;
+	return (long)(micros() - _rdsNextReadUs) >= 0;
+}
+
+/* microseconds until rdsDue() becomes true. 0 = due now or not predicted (poll normally) */
+uint32_t QN8027Radio::rdsWakeDelayUs(){
+	if(!_rdsInFlight || rdsPrediction == OFF) return 0;
+	unsigned long nextUs = _rdsPredictMiss ? _rdsLastReadUs + RDS_WAKE_EARLY_US : _rdsNextReadUs;
+	long wait = (long)(nextUs - micros());
+	return wait > 0 ? wait : 0;
+}
+
+uint32_t QN8027Radio::rdsGroupPeriodUs(){
+	return _rdsPeriodUs;
+}
+
+/* called after a group is pushed, plans when STATUS_REG is worth reading */
+void QN8027Radio::planRDSRead(){
+	if(rdsPrediction == OFF) return;
+	unsigned long nowUs = micros();
+	if(!_rdsToggleValid || nowUs - _rdsToggleUs > 8UL * _rdsPeriodUs){
+		_rdsPredictMiss = true;		//no recent toggle to count from
+		return;
+	}
+	unsigned long expectUs = _rdsToggleUs + _rdsPeriodUs;
+	while((long)(expectUs - nowUs) < 0) expectUs += _rdsPeriodUs;	//chip was idle, it takes group at next boundary
+	_rdsExpectUs = expectUs;
+	_rdsNextReadUs = expectUs - RDS_WAKE_EARLY_US;
+	_rdsLateRead = false;
+	_rdsPredictMiss = false;
+}
+
+/* STATUS_REG read showed no toggle yet */
+void QN8027Radio::rdsNoToggle(unsigned long nowUs){
+	_rdsLastReadUs = nowUs;
+	if(rdsPrediction == OFF || _rdsPredictMiss) return;
+	if((long)(nowUs - _rdsNextReadUs) < 0) return;		//extra read from poll(), not one prediction planned
+	if(!_rdsLateRead){
+		_rdsLateRead = true;
+		_rdsNextReadUs = _rdsExpectUs + RDS_WAKE_EARLY_US;
+	}else{
+		rdsPredictMisses++;
+		_rdsPredictMiss = true;
+	}
+}
+
+/* STATUS_REG read showed toggle, learn group period from it */
+void QN8027Radio::rdsToggleSeen(unsigned long nowUs){
+	unsigned long toggleUs = nowUs;
+	if(nowUs - _rdsLastReadUs <= 4UL * RDS_WAKE_EARLY_US + 10000UL){
+		toggleUs = _rdsLastReadUs + (nowUs - _rdsLastReadUs) / 2;
+	}
+	if(_rdsToggleValid){
+		unsigned long delta = toggleUs - _rdsToggleUs;
+		unsigned long groups = (delta + _rdsPeriodUs / 2) / _rdsPeriodUs;
+		if(groups >= 1 && groups <= 4){
+			long sample = delta / groups;
+			long period = _rdsPeriodUs + (sample - (long)_rdsPeriodUs) / 8;
+			if(period < (long)(RDS_GROUP_US - RDS_GROUP_US / 16)) period = RDS_GROUP_US - RDS_GROUP_US / 16;
+			if(period > (long)(RDS_GROUP_US + RDS_GROUP_US / 16)) period = RDS_GROUP_US + RDS_GROUP_US / 16;
+			_rdsPeriodUs = period;
+		}
+	}
+	_rdsToggleUs = toggleUs;
+	_rdsToggleValid = true;
+	
+	rdsLastGroupPolls = _rdsGroupPolls;
+	if(_rdsGroupPolls > rdsMaxGroupPolls) rdsMaxGroupPolls = _rdsGroupPolls;
+	rdsGroupPolls += _rdsGroupPolls;
+	_rdsGroupPolls = 0;
+}
+
 /*
 Sends Station Name such as "MbPCM FM" to a RDS enabled receiver.
 SN must be maximum 8 byte long String. 
+groups replace previous station name and pollRDS() keeps sending them in their own slots (see setRDSMix()).
+returns false when SN does not fit.
 */
-void QN8027Radio::sendStationName(String SN){
-	int str_len = SN.length() + 1;
-	str_len += str_len%2; //making it multiple of 2
-	char char_array[str_len];
-	SN.toCharArray(char_array, str_len);
-	
-	for(int i=0;i<str_len;i+=2){
-		sendRDS(0x64,0x00,0x02,0x68+(i/2),0xE0,0xCD,char_array[i],char_array[i+1]);
-		waitForRDSSend();
+bool QN8027Radio::sendStationName(const String &SN){
+	char text[RDS_PS_CHARS];
+	memset(text,' ',RDS_PS_CHARS);			//short names are padded with spaces
+	uint8_t len = SN.length() < RDS_PS_CHARS ? SN.length() : RDS_PS_CHARS;
+	memcpy(text,SN.c_str(),len);
+	if(_psCount == RDS_PS_GROUPS && memcmp(text,_psText,RDS_PS_CHARS) == 0){
+		return SN.length() <= RDS_PS_CHARS;	//same name, groups are already encoded
 	}
+	memcpy(_psText,text,RDS_PS_CHARS);
 	
+	for(uint8_t seg=0;seg<RDS_PS_GROUPS;seg++){
+		uint8_t *group = _psGroups[seg];
+		group[0] = 0x64;					//PI code
+		group[1] = 0x00;
+		group[2] = 0x02;					//group 0A, PTY
+		group[3] = 0x68 + seg;				//PTY, MS, segment address
+		group[4] = 0xE0;					//alternative frequency: none
+		group[5] = 0xCD;
+		group[6] = text[seg*2];
+		group[7] = text[seg*2+1];
+	}
+	_psCount = RDS_PS_GROUPS;
+	if(_psIndex >= _psCount) _psIndex = 0;
+	return SN.length() <= RDS_PS_CHARS;
 }
 /*
 waits for previous Group send. when previous group will finish sending, this function will return.
+gives up after RDS_TIMEOUT_MS and returns false so a chip which never toggles cannot hang caller.
 */
-void QN8027Radio::waitForRDSSend(){
+bool QN8027Radio::waitForRDSSend(){
 	uint8_t status = rdsSentStatus;
 	do{
+		if(millis() - _rdsPushedAt >= RDS_TIMEOUT_MS){
+			rdsTimeouts++;
+			return false;
+		}
 		delay(10); //set this delay according to receiver device. 10ms is suitable for Samsung M01
-		status = read1Byte(STATUS_REG);
-		status = status & 8;
+		uint8_t raw;
+		if(!readBurst(STATUS_REG,&raw,1)) continue;	//failed read is not a toggle
+		status = raw & 8;
 		
 	}while(status==rdsSentStatus);
 	rdsSentStatus = status;
+	rdsGroupsSent++;
+	return true;
 }
-/*Sends Song Artist Album Name. RT must be maximum 64 Byte long*/
-void QN8027Radio::sendRadioText(String RT){
-	int str_len = RT.length() + 1;
-	str_len += str_len%4; //making it multiple of 4
-	char char_array[str_len];
-	RT.toCharArray(char_array, str_len);
-	
+/*Sends Song Artist Album Name. RT must be maximum 64 Byte long
+text is encoded once into ceil(length/4) groups (last one padded with spaces) and pollRDS() keeps sending them
+whenever there is no station name due and nothing queued. calling it again with same text costs nothing.
+when text changes, Text A/B flag is flipped so receivers clear old text before showing new one.
+returns false when RT was longer than 64 characters and got cut.
+*/
+bool QN8027Radio::sendRadioText(const String &RT){
+	uint8_t len = RT.length() < RDS_RT_CHARS ? RT.length() : RDS_RT_CHARS;
+	if(len == _rtLen && memcmp(RT.c_str(),_rtText,len) == 0){
+		return RT.length() <= RDS_RT_CHARS;	//same text, groups are already encoded
+	}
+	if(_rtLen) _rtABFlag ^= 0x10;
+	memcpy(_rtText,RT.c_str(),len);
+	_rtLen = len;
 	
-	for(int i=0;i<str_len;i+=4){
-		sendRDS(0x64,0x00,0x22,0x60+(i/4),char_array[i],char_array[i+1],char_array[i+2],char_array[i+3]);
-		waitForRDSSend();
+	uint8_t segments = (len + 3) / 4;
+	char text[RDS_RT_CHARS];
+	memset(text,' ',sizeof(text));
+	memcpy(text,RT.c_str(),len);
+	for(uint8_t seg=0;seg<segments;seg++){
+		uint8_t *group = _rtGroups[seg];
+		group[0] = 0x64;					//PI code
+		group[1] = 0x00;
+		group[2] = 0x22;					//group 2A, PTY
+		group[3] = 0x60 | _rtABFlag | seg;	//PTY, Text A/B, segment address
+		memcpy(&group[4],&text[seg*4],4);
 	}
+	_rtCount = segments;
+	if(_rtIndex >= _rtCount) _rtIndex = 0;
+	return RT.length() <= RDS_RT_CHARS;
 }
 
 
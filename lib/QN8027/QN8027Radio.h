@@ -1,6 +1,7 @@
 /* Written By ManojBhakarPCM with little help of other's code copy paste */
 
 #include <Wire.h>
+#include <QN8027Trace.h>
 
 #ifndef QN8027Radio_h
 #define QN8027Radio_h
@@ -27,6 +28,19 @@
 #define     	PAC_REG               0x10
 #define     	FDEV_REG              0x11
 #define     	RDS_REG               0x12
+#define     	QN8027_REG_COUNT      0x13
+
+//bit masks of registers (1 << regAddr)
+#define 		QN8027_WRITABLE_REGS  0x7FF1FUL	//all except CID1, CID2, STATUS
+#define 		QN8027_CONFIG_REGS	  0x7001FUL	//SYSTEM..VGA and PAC..RDS
+#define 		QN8027_BURST_MAX_GAP  2			//clean registers flush() may rewrite to merge two bursts
+
+//bus errors, see setRetryPolicy()
+#define 		QN8027_I2C_RETRIES	  3			//attempts after the first one
+#define 		QN8027_I2C_BACKOFF_US 500		//wait before first retry, doubles for every next one
+#define 		QN8027_I2C_BUDGET_US  25000		//no retry starts later than this after the first attempt
+#define 		QN8027_I2C_NACK_ADDR  2			//Wire results that show bus itself is working
+#define 		QN8027_I2C_NACK_DATA  3
 
 
 
@@ -36,13 +50,161 @@
 #define 		CH0_MASK			  0x03
 #define 		POWER_MAX			  75
 #define			POWER_MIN			  20
+#define 		FSM_TRANSMITTING	  5		//getFSMStatus() value while carrier is on air
+
+//channels, all frequencies are in 10 kHz units (8810 == 88.10 MHz)
+#define 		QN8027_CHANNEL_MIN	  7600
+#define 		QN8027_CHANNEL_MAX	  10800
+#define 		QN8027_CHANNEL_STEP	  5		//chip tunes in 50 kHz steps
+
+struct QN8027ChannelPlan
+{
+  uint16_t min10kHz;
+  uint16_t max10kHz;
+  uint8_t step10kHz;
+};
+
+constexpr QN8027ChannelPlan QN8027_PLAN_FULL  = {7600, 10800, 5};	//everything chip can do
+constexpr QN8027ChannelPlan QN8027_PLAN_JAPAN = {7600, 9000, 10};	//76 - 90 MHz, 100 kHz raster
+constexpr QN8027ChannelPlan QN8027_PLAN_WORLD = {8750, 10800, 10};	//87.5 - 108 MHz, 100 kHz raster
+
+constexpr bool channelPlanFitsChip(const QN8027ChannelPlan &plan)
+{
+  return plan.min10kHz >= QN8027_CHANNEL_MIN && plan.max10kHz <= QN8027_CHANNEL_MAX &&
+         plan.min10kHz < plan.max10kHz && plan.step10kHz % QN8027_CHANNEL_STEP == 0 &&
+         (plan.min10kHz - QN8027_CHANNEL_MIN) % QN8027_CHANNEL_STEP == 0 &&
+         (plan.max10kHz - plan.min10kHz) % plan.step10kHz == 0;
+}
+static_assert(channelPlanFitsChip(QN8027_PLAN_FULL), "QN8027_PLAN_FULL does not fit chip channel grid");
+static_assert(channelPlanFitsChip(QN8027_PLAN_JAPAN), "QN8027_PLAN_JAPAN does not fit chip channel grid");
+static_assert(channelPlanFitsChip(QN8027_PLAN_WORLD), "QN8027_PLAN_WORLD does not fit chip channel grid");
+
+inline bool channelInPlan(const QN8027ChannelPlan &plan, uint16_t ch10kHz)
+{
+  return ch10kHz >= plan.min10kHz && ch10kHz <= plan.max10kHz && (ch10kHz - plan.min10kHz) % plan.step10kHz == 0;
+}
+
+//RDS queue
+#define 		RDS_QUEUE_LEN		  16	//groups other than station name and radio text
+#define 		RDS_PS_CHARS		  8
+#define 		RDS_PS_GROUPS		  4		//station name is 8 characters, 2 per group
+#define 		RDS_RT_CHARS		  64
+#define 		RDS_RT_GROUPS		  16	//radio text is upto 64 characters, 4 per group
+#define 		RDS_GROUP_MS		  88	//one group is ~87.6ms on air
+#define 		RDS_GROUP_US		  87600UL
+#define 		RDS_WAKE_EARLY_US	  1500	//prediction reads this much before and after expected toggle
+#define 		RDS_TIMEOUT_MS		  250
+#define 		RDS_DEFAULT_PS_PER_SEC 4
+#define 		RDS_MAX_RETRIES		  2
+
+//peakClearPolicy
+#define 		PEAK_CLEAR_MANUAL	  0		//poll() never writes, call clearAudioPeak() yourself
+#define 		PEAK_CLEAR_ON_POLL	  1		//poll() clears peak after reading it
+
+//audio level control, see setAGC()
+#define 		AGC_PEAK_HIGH		  13	//peak (0-15) at or above this steps gain down (attack)
+#define 		AGC_PEAK_LOW		  8		//peak staying below this steps gain up (release)
+#define 		AGC_ATTACK_MS		  200	//at most one step down per this time
+#define 		AGC_RELEASE_MS		  3000	//peak must stay low this long before one step up
+#define 		AGC_MAX_DEV_10HZ	  7500	//75 kHz deviation limit, in 10 Hz units
+#define 		AGC_FDEV_STEP		  4		//limiter step, 4 x 0.58 = 2.3 kHz
+#define 		AGC_MAX_IBGAIN		  5
+
+//one STATUS_REG read, decoded
+struct StatusSnapshot
+{
+  uint8_t raw;
+  uint8_t fsm;					//bits 2:0, FSM_TRANSMITTING while on air
+  uint8_t rdsToggle;			//bit 3, 8 or 0
+  uint8_t audioPeak;			//bits 7:4, x45 mV
+  unsigned long timeMs;			//millis() of the read
+};
 
+//called with true before and false after every I2C transaction, see setBusHook()
+typedef void (*QN8027BusHook)(bool take);
+//called while bus is held after a transaction failed other than by NACK, see setBusRecovery()
+typedef bool (*QN8027BusRecovery)();
 
 class QN8027Radio
 {
 private:
   uint8_t _address;
-  uint8_t freqH;
+  QN8027BusHook _busHook = NULL;
+  QN8027BusRecovery _busRecovery = NULL;
+  QN8027Trace *_trace = NULL;
+  uint8_t _retries = QN8027_I2C_RETRIES;
+  uint32_t _budgetUs = QN8027_I2C_BUDGET_US;
+  uint8_t freqH = 0;
+  uint8_t freqL = 0;
+  bool _holdWrites = false;
+  
+  uint8_t _shadow[QN8027_REG_COUNT];		//value setters want in each register
+  uint8_t _chipRegs[QN8027_REG_COUNT];	//value last written to each register
+  uint32_t _knownRegs = 0;				//bit set == _chipRegs holds what chip has
+  uint32_t _dirtyRegs = 0;				//bit set == _shadow not written to chip yet
+  
+  void stageReg(uint8_t regAddr,uint8_t value);
+  void autoFlush();
+  bool transaction(uint8_t reg,bool read,uint8_t *data,uint8_t len);
+  void backoff(uint32_t us);
+  
+  uint8_t _rdsQueue[RDS_QUEUE_LEN][8];
+  uint8_t _rdsHead = 0;
+  uint8_t _rdsCount = 0;
+  const uint8_t *_rdsGroupPtr = NULL;	//group in flight
+  bool _rdsFromQueue = false;			//group in flight is head of queue
+  bool _rdsInFlight = false;
+  uint8_t _rdsTries = 0;
+  unsigned long _rdsPushedAt = 0;
+  
+  uint8_t _psGroups[RDS_PS_GROUPS][8];	//station name, sent in its own slots
+  char _psText[RDS_PS_CHARS];
+  uint8_t _psCount = 0;
+  uint8_t _psIndex = 0;
+  uint16_t _psIntervalMs = 1000 / RDS_DEFAULT_PS_PER_SEC;
+  unsigned long _psDueAt = 0;
+  
+  uint8_t _rtGroups[RDS_RT_GROUPS][8];	//radio text, encoded once
+  char _rtText[RDS_RT_CHARS];
+  uint8_t _rtLen = 0;
+  uint8_t _rtCount = 0;
+  uint8_t _rtIndex = 0;
+  uint8_t _rtABFlag = 0;				//0x10 or 0, flipped on every new text
+  
+  //RDS cadence prediction
+  uint32_t _rdsPeriodUs = RDS_GROUP_US;	//learned group period
+  unsigned long _rdsToggleUs = 0;		//estimated time of last toggle
+  bool _rdsToggleValid = false;
+  unsigned long _rdsExpectUs = 0;		//expected time of next toggle
+  unsigned long _rdsNextReadUs = 0;
+  unsigned long _rdsLastReadUs = 0;
+  bool _rdsLateRead = false;			//first read (before expected toggle) done
+  bool _rdsPredictMiss = true;			//poll on every call until next toggle
+  uint16_t _rdsGroupPolls = 0;
+  
+  //retune latency measurement
+  bool _retunePending = false;			//channel staged but not written yet
+  bool _retuneMeasuring = false;
+  bool _retuneLeftTx = false;
+  unsigned long _retuneStartUs = 0;
+  
+  void noteFSMStatus(uint8_t fsm);
+  void pushRDSGroup(const uint8_t *group);
+  const uint8_t *nextRDSGroup();
+  void rdsGroupDone();
+  void planRDSRead();
+  void rdsNoToggle(unsigned long nowUs);
+  void rdsToggleSeen(unsigned long nowUs);
+  void serviceRDS(uint8_t status,unsigned long nowUs,bool rdsRead);
+  
+  //audio level control
+  bool _agcOn = false;
+  uint8_t _nominalFdev = 129;			//deviation set by setTxFreqDeviation(), limiter never goes above it
+  unsigned long _agcLastChange = 0;
+  unsigned long _agcLowSince = 0;
+  unsigned long _agcLastSample = 0;
+  void agcStep(uint8_t peak);
+  bool readSnapshot(bool rdsRead);
 
 public:
   //SYSTEM
@@ -80,14 +242,63 @@ public:
   
   uint8_t rdsSentStatus = 0;		//Toggle between 8 and 0 when RDS is sent successfully.
   
+  //RDS counters
+  uint32_t rdsGroupsSent = 0;		//groups taken by chip
+  uint32_t rdsTimeouts = 0;			//times chip did not toggle in RDS_TIMEOUT_MS
+  uint32_t rdsRetries = 0;			//groups pushed again after timeout
+  uint32_t rdsDropped = 0;			//groups given up after RDS_MAX_RETRIES
+  uint32_t rdsLateGroups = 0;		//station name groups sent a group time or more after due
+  uint32_t rdsQueueOverflows = 0;	//groups refused because queue was full
+  uint8_t rdsQueuePeak = 0;			//highest queue depth seen
+  
+  uint8_t rdsPrediction = OFF;		//ON == read STATUS_REG only around predicted toggles
+  uint32_t rdsPredictMisses = 0;	//toggle not seen at predicted time
+  uint16_t rdsLastGroupPolls = 0;	//STATUS reads last group cost
+  uint16_t rdsMaxGroupPolls = 0;
+  uint32_t rdsGroupPolls = 0;		//STATUS reads for all groups, divide by rdsGroupsSent for average
+  
+  uint32_t retuneLatencyUs = 0;		//last retune write until STATUS showed Transmitting
+  bool retuneDeadAir = false;		//last retune left Transmitting state in between
+  
+  uint8_t peakClearPolicy = PEAK_CLEAR_MANUAL;
+  
+  uint32_t agcAdjustments = 0;		//gain or deviation steps made by setAGC() loop
+  uint32_t agcOverLimitMs = 0;		//time estimated deviation was over AGC_MAX_DEV_10HZ
+  StatusSnapshot lastStatus = {0, 0, 0, 0, 0};	//from last poll() or pollRDS() read
+  
+  //I2C errors
+  uint8_t lastError = 0;			//Wire result of last transaction, 0 == ok, QN8027_TRACE_SHORT_READ == read came short
+  uint32_t i2cErrors = 0;			//failed transactions, retries included
+  uint32_t i2cRetries = 0;			//transactions made again after a failure
+  uint32_t i2cFailures = 0;			//calls given up after all retries, write did not land
+  uint32_t busRecoveries = 0;		//times recovery function freed a stuck bus
+  uint16_t regErrors[QN8027_REG_COUNT] = {0};	//failed transactions touching each register
+  
   
   
   
   QN8027Radio();
   QN8027Radio(int address);
-  void write1Byte(uint8_t regAddr,uint8_t comData);
+  void setBusHook(QN8027BusHook hook);
+  void setTrace(QN8027Trace *trace);
+  void setBusRecovery(QN8027BusRecovery recovery);
+  void setRetryPolicy(uint8_t retries,uint32_t budgetUs);
+  void clearErrorCounts();
+  bool write1Byte(uint8_t regAddr,uint8_t comData);
+  bool writeBurst(uint8_t startReg,const uint8_t *data,uint8_t len);
+  bool writeRegs(uint8_t startReg,const uint8_t *data,uint8_t len);
+  bool updateAllRegs();
+  void getRegImage(uint8_t *image);
+  bool loadRegImage(const uint8_t *image);
+  void beginUpdate();
+  bool endUpdate();
+  bool flush();
+  bool writesPending();
   
   void setFrequency(float frequency);
+  bool setFrequencyKHz(uint32_t frequencyKHz);
+  bool setChannel(uint16_t ch10kHz);
+  void retune();
   void reset();
   void reCalibrate();
   void mute(uint8_t onOffCtrl);
@@ -96,13 +307,31 @@ public:
   void setPreEmphTime50(uint8_t onOffCtrl);
   void Switch(uint8_t onOffCtrl); //radioPower
   void sendRDS(char By0,char By1,char By2,char By3,char By4,char By5,char By6,char By7);
-  void sendStationName(String SN);
-  void sendRadioText(String RT);
-  void waitForRDSSend();
+  bool sendStationName(const String &SN);
+  bool sendRadioText(const String &RT);
+  bool waitForRDSSend();
+  
+  bool queueRDS(const uint8_t *group);
+  uint8_t rdsQueueDepth();
+  bool rdsIdle();
+  void clearRDSQueue();
+  void setRDSMix(uint8_t psPerSecond);
+  void setRDSPrediction(uint8_t onOffCtrl);
+  bool rdsDue();
+  uint32_t rdsWakeDelayUs();
+  uint32_t rdsGroupPeriodUs();
+  bool pollRDS();
+  StatusSnapshot poll();
+  void setPeakClearPolicy(uint8_t policy);
+  void setAGC(uint8_t onOffCtrl);
+  uint16_t estimatedDeviation10Hz(uint8_t peak);
   
   
   float getFrequency();
+  uint16_t getChannel();
   uint8_t read1Byte(uint8_t regAddr);
+  uint8_t readBurst(uint8_t startReg,uint8_t *data,uint8_t len);
+  uint8_t readStatus(uint16_t *channel);
   uint8_t canRDSbeSent();
   uint8_t getFSMStatus();
   uint8_t getAudioInpPeak();
@@ -112,6 +341,9 @@ public:
   void updateGPLT_REG();
   void updateXTL_REG();
   void updateVGA_REG();
+  void updatePAC_REG();
+  void updateFDEV_REG();
+  void updateRDS_REG();
   
   void setCrystalFreq(uint8_t Freq);
   void setTxInputBufferGain(uint8_t IBGain);
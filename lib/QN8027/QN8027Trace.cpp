@@ -0,0 +1,181 @@
+/*
+Records every QN8027Radio I2C transaction into a RAM ring buffer, so the exact bus sequence of a
+transmitter misbehaving on site can be downloaded and replayed on a host (native/QN8027Sim).
+	QN8027Trace trace;
+	trace.begin(16384);
+	radio.setTrace(&trace);
+	...
+	size_t len = trace.copy(buf,sizeof(buf));
+a record is 8 bytes plus data, a STATUS poll costs 9 bytes, an RDS group 16 + 9.
+ring lives in PSRAM when board has it.
+*/
+
+#include <QN8027Trace.h>
+
+/* allocates ring of bytes and starts recording. can be called again to change size, old records are lost */
+bool QN8027Trace::begin(size_t bytes)
+{
+	if(_mutex == NULL) _mutex = xSemaphoreCreateMutex();
+	xSemaphoreTake(_mutex,portMAX_DELAY);
+	_on = false;
+	free(_ring);
+	_ring = NULL;
+#ifdef BOARD_HAS_PSRAM
+	_ring = (uint8_t *)ps_malloc(bytes);
+#endif
+	if(_ring == NULL) _ring = (uint8_t *)malloc(bytes);
+	_size = _ring != NULL ? bytes : 0;
+	xSemaphoreGive(_mutex);
+	clear();
+	_on = _ring != NULL;
+	return _on;
+}
+
+void QN8027Trace::end()
+{
+	if(_mutex == NULL) return;
+	xSemaphoreTake(_mutex,portMAX_DELAY);
+	_on = false;
+	free(_ring);
+	_ring = NULL;
+	_size = 0;
+	_head = 0;
+	_used = 0;
+	records = 0;
+	xSemaphoreGive(_mutex);
+}
+
+void QN8027Trace::start()
+{
+	_on = _ring != NULL;
+}
+
+void QN8027Trace::stop()
+{
+	_on = false;
+}
+
+bool QN8027Trace::recording()
+{
+	return _on;
+}
+
+size_t QN8027Trace::capacity()
+{
+	return _size;
+}
+
+void QN8027Trace::clear()
+{
+	if(_mutex) xSemaphoreTake(_mutex,portMAX_DELAY);
+	_head = 0;
+	_used = 0;
+	records = 0;
+	recorded = 0;
+	dropped = 0;
+	if(_mutex) xSemaphoreGive(_mutex);
+}
+
+/* can grow before copy() is called while recording, stop() first or leave some room */
+size_t QN8027Trace::imageSize()
+{
+	return QN8027_TRACE_HEADER + _used;
+}
+
+void QN8027Trace::put(size_t pos,const uint8_t *data,size_t len)
+{
+	for(size_t i = 0; i < len; i++){
+		_ring[(pos + i) % _size] = data[i];
+	}
+}
+
+void QN8027Trace::get(size_t pos,uint8_t *data,size_t len)
+{
+	for(size_t i = 0; i < len; i++){
+		data[i] = _ring[(pos + i) % _size];
+	}
+}
+
+void QN8027Trace::dropOldest()
+{
+	uint8_t header[QN8027_TRACE_REC_HEADER];
+	get(_head,header,sizeof(header));
+	size_t recLen = QN8027_TRACE_REC_HEADER + header[7];
+	_head = (_head + recLen) % _size;
+	_used -= recLen;
+	records--;
+	dropped++;
+}
+
+/* called by QN8027Radio while it holds the bus, so records are in bus order */
+void QN8027Trace::record(uint8_t address,uint8_t reg,bool read,const uint8_t *data,uint8_t len,uint8_t result,uint32_t timeUs)
+{
+	if(!_on) return;
+	if(len > QN8027_TRACE_DATA_MAX) len = QN8027_TRACE_DATA_MAX;
+	size_t recLen = QN8027_TRACE_REC_HEADER + len;
+	uint8_t header[QN8027_TRACE_REC_HEADER] = {
+		(uint8_t)timeUs,(uint8_t)(timeUs >> 8),(uint8_t)(timeUs >> 16),(uint8_t)(timeUs >> 24),
+		address,reg,(uint8_t)((read ? QN8027_TRACE_READ : 0) | (result & QN8027_TRACE_RESULT_MASK)),len
+	};
+	xSemaphoreTake(_mutex,portMAX_DELAY);
+	if(recLen > _size){					//end() or a smaller begin() came in between
+		xSemaphoreGive(_mutex);
+		return;
+	}
+	while(_size - _used < recLen) dropOldest();
+	size_t tail = (_head + _used) % _size;
+	put(tail,header,sizeof(header));
+	put(tail + sizeof(header),data,len);
+	_used += recLen;
+	records++;
+	recorded++;
+	xSemaphoreGive(_mutex);
+}
+
+/* trace image oldest record first, returns its length or 0 when maxLen is smaller than imageSize() */
+size_t QN8027Trace::copy(uint8_t *image,size_t maxLen)
+{
+	if(_mutex == NULL) return 0;
+	xSemaphoreTake(_mutex,portMAX_DELAY);
+	size_t len = QN8027_TRACE_HEADER + _used;
+	if(len <= maxLen){
+		uint8_t header[QN8027_TRACE_HEADER] = {
+			'Q','N','T','R',QN8027_TRACE_VERSION,0,0,0,
+			(uint8_t)dropped,(uint8_t)(dropped >> 8),(uint8_t)(dropped >> 16),(uint8_t)(dropped >> 24)
+		};
+		memcpy(image,header,sizeof(header));
+		get(_head,image + sizeof(header),_used);
+	}else{
+		len = 0;
+	}
+	xSemaphoreGive(_mutex);
+	return len;
+}
+
+QN8027TraceReader::QN8027TraceReader(const uint8_t *image,size_t len) : _image(image), _len(len), _pos(QN8027_TRACE_HEADER)
+{
+	if(valid()){
+		dropped = image[8] | (image[9] << 8) | (image[10] << 16) | ((uint32_t)image[11] << 24);
+	}
+}
+
+bool QN8027TraceReader::valid()
+{
+	return _len >= QN8027_TRACE_HEADER && memcmp(_image,"QNTR",4) == 0 && _image[4] == QN8027_TRACE_VERSION;
+}
+
+bool QN8027TraceReader::next(QN8027TraceRecord *rec)
+{
+	if(!valid() || _pos + QN8027_TRACE_REC_HEADER > _len) return false;
+	const uint8_t *p = _image + _pos;
+	if(_pos + QN8027_TRACE_REC_HEADER + p[7] > _len) return false;
+	rec->timeUs = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+	rec->address = p[4];
+	rec->reg = p[5];
+	rec->read = p[6] & QN8027_TRACE_READ;
+	rec->result = p[6] & QN8027_TRACE_RESULT_MASK;
+	rec->len = p[7];
+	rec->data = p + QN8027_TRACE_REC_HEADER;
+	_pos += QN8027_TRACE_REC_HEADER + rec->len;
+	return true;
+}
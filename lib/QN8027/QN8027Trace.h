@@ -0,0 +1,85 @@
+/* I2C transaction recorder of QN8027Radio, see QN8027Radio::setTrace() */
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#ifndef QN8027Trace_h
+#define QN8027Trace_h
+
+/*
+trace image, what copy() gives and what a host replays. all numbers little endian.
+	header	"QNTR", version, 3 reserved bytes, records dropped (uint32)
+	record	timeUs (uint32, micros() after bus was taken), I2C address, register, flags, len, len data bytes
+			flags bit 7 = read, bits 2:0 = Wire result (0 ok, 2 address NACK, 3 data NACK ..., 4 short read)
+			len of a read is what was asked for, bytes not received are not valid
+records are oldest first. when ring is full oldest records are dropped to make room.
+*/
+#define 		QN8027_TRACE_VERSION	  1
+#define 		QN8027_TRACE_HEADER		  12
+#define 		QN8027_TRACE_REC_HEADER	  8
+#define 		QN8027_TRACE_READ		  0x80
+#define 		QN8027_TRACE_RESULT_MASK  0x07
+#define 		QN8027_TRACE_SHORT_READ	  4
+#define 		QN8027_TRACE_DATA_MAX	  32		//longer transfers keep first 32 bytes
+
+struct QN8027TraceRecord
+{
+  uint32_t timeUs;
+  uint8_t address;
+  uint8_t reg;
+  bool read;
+  uint8_t result;
+  uint8_t len;
+  const uint8_t *data;				//points into trace image
+};
+
+class QN8027Trace
+{
+private:
+  uint8_t *_ring = NULL;
+  size_t _size = 0;
+  size_t _head = 0;						//oldest record
+  size_t _used = 0;
+  bool _on = false;
+  SemaphoreHandle_t _mutex = NULL;
+
+  void put(size_t pos,const uint8_t *data,size_t len);
+  void get(size_t pos,uint8_t *data,size_t len);
+  void dropOldest();
+
+public:
+  uint32_t records = 0;				//records in ring
+  uint32_t recorded = 0;			//since clear()
+  uint32_t dropped = 0;				//overwritten by newer ones
+
+  bool begin(size_t bytes);
+  void end();
+  void start();
+  void stop();						//keeps what was recorded, for download after a fault
+  void clear();
+  bool recording();
+  size_t capacity();
+  size_t imageSize();				//bytes copy() needs
+
+  void record(uint8_t address,uint8_t reg,bool read,const uint8_t *data,uint8_t len,uint8_t result,uint32_t timeUs);
+  size_t copy(uint8_t *image,size_t maxLen);
+};
+
+/* walks over a trace image, on chip or on host */
+class QN8027TraceReader
+{
+private:
+  const uint8_t *_image;
+  size_t _len;
+  size_t _pos;
+
+public:
+  uint32_t dropped = 0;
+
+  QN8027TraceReader(const uint8_t *image,size_t len);
+  bool valid();
+  bool next(QN8027TraceRecord *rec);	//false at end or on a cut record
+};
+
+#endif
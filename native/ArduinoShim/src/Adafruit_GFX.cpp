@@ -0,0 +1,45 @@
+#include <Adafruit_GFX.h>
+
+void Adafruit_GFX::fillRect(int16_t x,int16_t y,int16_t w,int16_t h,uint16_t color)
+{
+	for(int16_t i = x; i < x + w; i++){
+		for(int16_t j = y; j < y + h; j++) drawPixel(i,j,color);
+	}
+}
+
+void Adafruit_GFX::drawRect(int16_t x,int16_t y,int16_t w,int16_t h,uint16_t color)
+{
+	drawFastHLine(x,y,w,color);
+	drawFastHLine(x,y + h - 1,w,color);
+	drawFastVLine(x,y,h,color);
+	drawFastVLine(x + w - 1,y,h,color);
+}
+
+/* a box with the character code in its top row, enough to tell frames apart */
+void Adafruit_GFX::drawChar(int16_t x,int16_t y,unsigned char c,uint16_t color,uint16_t bg,uint8_t size)
+{
+	if(bg != color) fillRect(x,y,6 * size,8 * size,bg);
+	if(c == ' ') return;
+	for(int16_t i = 0; i < 5; i++){
+		for(int16_t j = 0; j < 7; j++){
+			bool on = j == 0 ? (c >> (i + 3)) & 1 : (i == 0 || i == 4 || j == 6);
+			if(on) fillRect(x + i * size,y + j * size,size,size,color);
+		}
+	}
+}
+
+size_t Adafruit_GFX::write(uint8_t c)
+{
+	if(c == '\n'){
+		_cursorX = 0;
+		_cursorY += 8 * _textSize;
+	} else if(c != '\r'){
+		if(_wrap && _cursorX + 6 * _textSize > _width){
+			_cursorX = 0;
+			_cursorY += 8 * _textSize;
+		}
+		drawChar(_cursorX,_cursorY,c,_textColor,_textBgColor,_textSize);
+		_cursorX += 6 * _textSize;
+	}
+	return 1;
+}
@@ -0,0 +1,43 @@
+/* drawing subset of Adafruit_GFX for host builds. text uses the same 6x8 cell as the classic font,
+	each glyph is drawn as a filled 5x7 box so changed text changes the frame buffer like on the chip.
+*/
+
+#ifndef _ADAFRUIT_GFX_H
+#define _ADAFRUIT_GFX_H
+
+#include <Arduino.h>
+
+class Adafruit_GFX : public Print
+{
+protected:
+  int16_t _width, _height;
+  int16_t _cursorX = 0, _cursorY = 0;
+  uint16_t _textColor = 1, _textBgColor = 1;
+  uint8_t _textSize = 1;
+  bool _wrap = true;
+
+public:
+  Adafruit_GFX(int16_t w,int16_t h) : _width(w), _height(h) {}
+  virtual void drawPixel(int16_t x,int16_t y,uint16_t color) = 0;
+  virtual void fillRect(int16_t x,int16_t y,int16_t w,int16_t h,uint16_t color);
+  void drawFastHLine(int16_t x,int16_t y,int16_t w,uint16_t color) { fillRect(x,y,w,1,color); }
+  void drawFastVLine(int16_t x,int16_t y,int16_t h,uint16_t color) { fillRect(x,y,1,h,color); }
+  void drawRect(int16_t x,int16_t y,int16_t w,int16_t h,uint16_t color);
+  void fillScreen(uint16_t color) { fillRect(0,0,_width,_height,color); }
+  void drawChar(int16_t x,int16_t y,unsigned char c,uint16_t color,uint16_t bg,uint8_t size);
+
+  void setCursor(int16_t x,int16_t y) { _cursorX = x; _cursorY = y; }
+  void setTextSize(uint8_t s) { _textSize = s > 0 ? s : 1; }
+  void setTextColor(uint16_t c) { _textColor = _textBgColor = c; }
+  void setTextColor(uint16_t c,uint16_t bg) { _textColor = c; _textBgColor = bg; }
+  void setTextWrap(bool w) { _wrap = w; }
+  int16_t getCursorX() const { return _cursorX; }
+  int16_t getCursorY() const { return _cursorY; }
+  int16_t width() const { return _width; }
+  int16_t height() const { return _height; }
+
+  using Print::write;
+  size_t write(uint8_t c) override;
+};
+
+#endif
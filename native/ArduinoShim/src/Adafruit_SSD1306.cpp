@@ -0,0 +1,83 @@
+#include <Adafruit_SSD1306.h>
+
+Adafruit_SSD1306::Adafruit_SSD1306(uint8_t w,uint8_t h,TwoWire *twi,int8_t rstPin,uint32_t clkDuring,uint32_t clkAfter)
+	: Adafruit_GFX(w,h), _wire(twi), _clockDuring(clkDuring), _clockAfter(clkAfter)
+{
+}
+
+Adafruit_SSD1306::~Adafruit_SSD1306()
+{
+	free(_buffer);
+}
+
+void Adafruit_SSD1306::commands(const uint8_t *list,uint8_t len)
+{
+	_wire->beginTransmission(_address);
+	_wire->write((uint8_t)0x00);
+	_wire->write(list,len);
+	_wire->endTransmission();
+}
+
+/* same init sequence as the library for a 128x64 panel with internal charge pump */
+bool Adafruit_SSD1306::begin(uint8_t switchvcc,uint8_t i2caddr,bool reset,bool periphBegin)
+{
+	if(_buffer == NULL && (_buffer = (uint8_t *)malloc(_width * ((_height + 7) / 8))) == NULL) return false;
+	clearDisplay();
+	if(i2caddr) _address = i2caddr;
+	if(periphBegin) _wire->begin();
+
+	bool external = switchvcc == SSD1306_EXTERNALVCC;
+	const uint8_t init1[] = {SSD1306_DISPLAYOFF, 0xD5, 0x80, 0xA8, (uint8_t)(_height - 1)};
+	const uint8_t init2[] = {0xD3, 0x00, 0x40, 0x8D, (uint8_t)(external ? 0x10 : 0x14)};
+	const uint8_t init3[] = {SSD1306_MEMORYMODE, 0x00, 0xA1, 0xC8};
+	const uint8_t init4[] = {0xDA, 0x12, 0x81, (uint8_t)(external ? 0x9F : 0xCF)};
+	const uint8_t init5[] = {0xD9, (uint8_t)(external ? 0x22 : 0xF1)};
+	const uint8_t init6[] = {0xDB, 0x40, 0xA4, 0xA6, 0x2E, SSD1306_DISPLAYON};
+	_wire->setClock(_clockDuring);
+	commands(init1,sizeof(init1));
+	commands(init2,sizeof(init2));
+	commands(init3,sizeof(init3));
+	commands(init4,sizeof(init4));
+	commands(init5,sizeof(init5));
+	commands(init6,sizeof(init6));
+	_wire->setClock(_clockAfter);
+	return true;
+}
+
+void Adafruit_SSD1306::display()
+{
+	const uint8_t window[] = {SSD1306_PAGEADDR, 0, 0xFF, SSD1306_COLUMNADDR, 0, (uint8_t)(_width - 1)};
+	_wire->setClock(_clockDuring);
+	commands(window,sizeof(window));
+	size_t count = _width * ((_height + 7) / 8);
+	for(size_t sent = 0; sent < count; ){
+		size_t chunk = count - sent < I2C_BUFFER_LENGTH - 1 ? count - sent : I2C_BUFFER_LENGTH - 1;
+		_wire->beginTransmission(_address);
+		_wire->write((uint8_t)0x40);
+		_wire->write(_buffer + sent,chunk);
+		_wire->endTransmission();
+		sent += chunk;
+	}
+	_wire->setClock(_clockAfter);
+}
+
+void Adafruit_SSD1306::clearDisplay()
+{
+	if(_buffer != NULL) memset(_buffer,0,_width * ((_height + 7) / 8));
+}
+
+void Adafruit_SSD1306::drawPixel(int16_t x,int16_t y,uint16_t color)
+{
+	if(_buffer == NULL || x < 0 || y < 0 || x >= _width || y >= _height) return;
+	uint8_t &cell = _buffer[x + (y / 8) * _width];
+	uint8_t mask = 1 << (y & 7);
+	if(color == SSD1306_WHITE) cell |= mask;
+	else if(color == SSD1306_BLACK) cell &= ~mask;
+	else cell ^= mask;
+}
+
+bool Adafruit_SSD1306::getPixel(int16_t x,int16_t y)
+{
+	if(_buffer == NULL || x < 0 || y < 0 || x >= _width || y >= _height) return false;
+	return _buffer[x + (y / 8) * _width] & (1 << (y & 7));
+}
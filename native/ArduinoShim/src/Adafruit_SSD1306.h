@@ -0,0 +1,46 @@
+/* Adafruit_SSD1306 of host builds: frame buffer in memory, begin() and display() talk to the panel
+	over the simulated Wire like the library does, so OLED traffic shows up in bus time and statistics.
+*/
+
+#ifndef _Adafruit_SSD1306_H_
+#define _Adafruit_SSD1306_H_
+
+#include <Adafruit_GFX.h>
+#include <Wire.h>
+
+#define 		SSD1306_BLACK		  0
+#define 		SSD1306_WHITE		  1
+#define 		SSD1306_INVERSE		  2
+#define 		BLACK				  SSD1306_BLACK
+#define 		WHITE				  SSD1306_WHITE
+
+#define 		SSD1306_EXTERNALVCC	  0x01
+#define 		SSD1306_SWITCHCAPVCC  0x02
+#define 		SSD1306_MEMORYMODE	  0x20
+#define 		SSD1306_COLUMNADDR	  0x21
+#define 		SSD1306_PAGEADDR	  0x22
+#define 		SSD1306_DISPLAYOFF	  0xAE
+#define 		SSD1306_DISPLAYON	  0xAF
+
+class Adafruit_SSD1306 : public Adafruit_GFX
+{
+private:
+  TwoWire *_wire;
+  uint8_t *_buffer = NULL;
+  uint8_t _address = 0x3C;
+  uint32_t _clockDuring;
+  uint32_t _clockAfter;
+  void commands(const uint8_t *list,uint8_t len);
+
+public:
+  Adafruit_SSD1306(uint8_t w,uint8_t h,TwoWire *twi = &Wire,int8_t rstPin = -1,uint32_t clkDuring = 400000UL,uint32_t clkAfter = 100000UL);
+  ~Adafruit_SSD1306();
+  bool begin(uint8_t switchvcc = SSD1306_SWITCHCAPVCC,uint8_t i2caddr = 0,bool reset = true,bool periphBegin = true);
+  void display();
+  void clearDisplay();
+  void drawPixel(int16_t x,int16_t y,uint16_t color) override;
+  bool getPixel(int16_t x,int16_t y);
+  uint8_t *getBuffer() { return _buffer; }
+};
+
+#endif
@@ -0,0 +1,99 @@
+#include <Arduino.h>
+#include <shim.h>
+
+static uint8_t pinLevels[64];
+static bool pinPulledLow[64];
+static ShimPinListener pinListener = NULL;
+
+unsigned long millis()
+{
+	return (unsigned long)(shimNowUs() / 1000);
+}
+
+unsigned long micros()
+{
+	return (unsigned long)shimNowUs();
+}
+
+/* like arduino-esp32, delay() is vTaskDelay() and lets other tasks run */
+void delay(uint32_t ms)
+{
+	vTaskDelay(ms / portTICK_PERIOD_MS);
+}
+
+/* busy wait on the chip, other tasks only run if they have higher priority */
+void delayMicroseconds(uint32_t us)
+{
+	shimBusyUs(us);
+}
+
+void yield()
+{
+	vTaskDelay(0);
+}
+
+static uint32_t randomState = 1;
+
+void randomSeed(unsigned long seed)
+{
+	if(seed != 0) randomState = seed;
+}
+
+long random(long howBig)
+{
+	if(howBig <= 0) return 0;
+	randomState = randomState * 1103515245UL + 12345UL;		//same sequence on every host
+	return (randomState >> 1) % howBig;
+}
+
+long random(long howSmall,long howBig)
+{
+	if(howSmall >= howBig) return howSmall;
+	return random(howBig - howSmall) + howSmall;
+}
+
+long map(long x,long inMin,long inMax,long outMin,long outMax)
+{
+	return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+void pinMode(uint8_t pin,uint8_t mode)
+{
+	if(pin < sizeof(pinLevels) && (mode == INPUT || mode == INPUT_PULLUP)) pinLevels[pin] = HIGH;
+}
+
+void digitalWrite(uint8_t pin,uint8_t val)
+{
+	if(pin < sizeof(pinLevels)) pinLevels[pin] = val ? HIGH : LOW;
+	if(pinListener) pinListener(pin,val ? HIGH : LOW);
+}
+
+/* wired AND: a pin another device pulls low reads LOW whatever this side drives */
+int digitalRead(uint8_t pin)
+{
+	if(pin >= sizeof(pinLevels) || pinPulledLow[pin]) return LOW;
+	return pinLevels[pin];
+}
+
+void shimPullLow(uint8_t pin,bool low)
+{
+	if(pin < sizeof(pinPulledLow)) pinPulledLow[pin] = low;
+}
+
+void shimOnPinWrite(ShimPinListener listener)
+{
+	pinListener = listener;
+}
+
+#ifdef SHIM_STRLCPY
+size_t strlcpy(char *dst,const char *src,size_t size)
+{
+	size_t len = strlen(src);
+	if(size != 0){
+		size_t n = len < size - 1 ? len : size - 1;
+		memcpy(dst,src,n);
+		dst[n] = '\0';
+	}
+	return len;
+}
+#endif
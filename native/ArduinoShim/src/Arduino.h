@@ -0,0 +1,78 @@
+/* Arduino core subset for host builds (pio run -e native). time comes from the virtual clock in Scheduler.cpp */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include <cmath>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <esp_timer.h>
+
+#include <WString.h>
+#include <Print.h>
+#include <Stream.h>
+#include <HardwareSerial.h>
+
+using std::min;
+using std::max;
+
+#define 		HIGH				  0x1
+#define 		LOW					  0x0
+#define 		INPUT				  0x01
+#define 		OUTPUT				  0x03
+#define 		INPUT_PULLUP		  0x05
+#define 		OUTPUT_OPEN_DRAIN	  0x13
+
+#define 		PI					  3.1415926535897932384626433832795
+#define 		constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+#define 		bitRead(value,bit)	  (((value) >> (bit)) & 0x01)
+#define 		bitSet(value,bit)	  ((value) |= (1UL << (bit)))
+#define 		bitClear(value,bit)	  ((value) &= ~(1UL << (bit)))
+#define 		bit(b)				  (1UL << (b))
+
+typedef bool boolean;
+typedef uint8_t byte;
+typedef uint16_t word;
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+long random(long howBig);
+long random(long howSmall,long howBig);
+void randomSeed(unsigned long seed);
+long map(long x,long inMin,long inMax,long outMin,long outMax);
+
+//GPIO only remembers levels, SCL/SDA are driven by the I2C model (Wire.cpp)
+void pinMode(uint8_t pin,uint8_t mode);
+void digitalWrite(uint8_t pin,uint8_t val);
+int digitalRead(uint8_t pin);
+
+#if defined(__GLIBC__)
+#if !__GLIBC_PREREQ(2,38)
+#define 		SHIM_STRLCPY
+#endif
+#elif !defined(__APPLE__)
+#define 		SHIM_STRLCPY
+#endif
+#ifdef SHIM_STRLCPY
+size_t strlcpy(char *dst,const char *src,size_t size);
+#endif
+
+void setup();
+void loop();
+
+#endif
@@ -0,0 +1,8 @@
+/* nothing to do on host builds, ESPAsyncWebServer.h has the whole server */
+
+#ifndef AsyncTCP_h
+#define AsyncTCP_h
+
+#include <Arduino.h>
+
+#endif
@@ -0,0 +1,75 @@
+#include <ESPAsyncWebServer.h>
+
+void AsyncWebServerRequest::send(int code,const String &contentType,const String &content)
+{
+	responseCode = code;
+	responseType = contentType;
+	responseBody = content;
+}
+
+void AsyncWebServerRequest::send(FS &fs,const String &path,const String &contentType,bool download)
+{
+	String content;
+	if(!fs.readFile(path.c_str(),content)){
+		send(404,"text/plain","Not found");
+		return;
+	}
+	send(200,contentType,content);
+}
+
+/* takes response over like the library does */
+void AsyncWebServerRequest::send(AsyncWebServerResponse *response)
+{
+	send(response->code,response->contentType,response->content);
+	delete response;
+}
+
+AsyncResponseStream *AsyncWebServerRequest::beginResponseStream(const String &contentType,size_t bufferSize)
+{
+	AsyncResponseStream *response = new AsyncResponseStream();
+	response->contentType = contentType;
+	return response;
+}
+
+size_t AsyncResponseStream::write(uint8_t data)
+{
+	return write(&data,1);
+}
+
+size_t AsyncResponseStream::write(const uint8_t *data,size_t len)
+{
+	content.concat((const char *)data,len);
+	return len;
+}
+
+void AsyncWebServer::on(const char *uri,WebRequestMethodComposite method,ArRequestHandlerFunction onRequest)
+{
+	on(uri,method,onRequest,NULL,NULL);
+}
+
+void AsyncWebServer::on(const char *uri,WebRequestMethodComposite method,ArRequestHandlerFunction onRequest,ArUploadHandlerFunction onUpload,ArBodyHandlerFunction onBody)
+{
+	Route route = {uri, method, onRequest, onBody};
+	_routes.push_back(route);
+}
+
+AsyncWebServerRequest AsyncWebServer::handle(WebRequestMethodComposite method,const char *url,const char *body)
+{
+	AsyncWebServerRequest request(method,url);
+	if(!_started){
+		request.responseCode = 503;
+		return request;
+	}
+	for(size_t i = 0; i < _routes.size(); i++){
+		Route &route = _routes[i];
+		if(!(route.method & method) || route.uri != url) continue;
+		if(body != NULL && route.onBody){
+			size_t len = strlen(body);
+			route.onBody(&request,(uint8_t *)body,len,0,len);
+		}
+		if(route.onRequest) route.onRequest(&request);
+		return request;
+	}
+	request.send(404,"text/plain","Not found");
+	return request;
+}
@@ -0,0 +1,92 @@
+/* AsyncWebServer of host builds. nothing listens on a socket: a request is handed to the server with
+	AsyncWebServer::handle() and runs the registered handlers in the calling task, response is returned to the caller.
+*/
+
+#ifndef ESPAsyncWebServer_h
+#define ESPAsyncWebServer_h
+
+#include <Arduino.h>
+#include <FS.h>
+#include <functional>
+#include <vector>
+
+typedef enum {
+  HTTP_GET = 0b00000001,
+  HTTP_POST = 0b00000010,
+  HTTP_DELETE = 0b00000100,
+  HTTP_PUT = 0b00001000,
+  HTTP_PATCH = 0b00010000,
+  HTTP_HEAD = 0b00100000,
+  HTTP_OPTIONS = 0b01000000,
+  HTTP_ANY = 0b01111111
+} WebRequestMethod;
+typedef uint8_t WebRequestMethodComposite;
+
+class AsyncWebServerResponse
+{
+public:
+  int code = 200;
+  String contentType;
+  String content;
+  virtual ~AsyncWebServerResponse() {}
+};
+
+//response built with print()/write() and sent in one piece
+class AsyncResponseStream : public AsyncWebServerResponse, public Print
+{
+public:
+  size_t write(uint8_t data) override;
+  size_t write(const uint8_t *data,size_t len) override;
+  using Print::write;
+};
+
+class AsyncWebServerRequest
+{
+private:
+  WebRequestMethodComposite _method;
+  String _url;
+
+public:
+  int responseCode = 0;
+  String responseType;
+  String responseBody;
+
+  AsyncWebServerRequest(WebRequestMethodComposite method,const String &url) : _method(method), _url(url) {}
+  WebRequestMethodComposite method() const { return _method; }
+  const String &url() const { return _url; }
+  void send(int code,const String &contentType = String(),const String &content = String());
+  void send(FS &fs,const String &path,const String &contentType = String(),bool download = false);
+  void send(AsyncWebServerResponse *response);
+  AsyncResponseStream *beginResponseStream(const String &contentType,size_t bufferSize = 1460);
+};
+
+typedef std::function<void(AsyncWebServerRequest *request)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest *request,const String &filename,size_t index,uint8_t *data,size_t len,bool final)> ArUploadHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest *request,uint8_t *data,size_t len,size_t index,size_t total)> ArBodyHandlerFunction;
+
+class AsyncWebServer
+{
+private:
+  struct Route
+  {
+    String uri;
+    WebRequestMethodComposite method;
+    ArRequestHandlerFunction onRequest;
+    ArBodyHandlerFunction onBody;
+  };
+  std::vector<Route> _routes;
+  uint16_t _port;
+  bool _started = false;
+
+public:
+  AsyncWebServer(uint16_t port) : _port(port) {}
+  void on(const char *uri,WebRequestMethodComposite method,ArRequestHandlerFunction onRequest);
+  void on(const char *uri,WebRequestMethodComposite method,ArRequestHandlerFunction onRequest,ArUploadHandlerFunction onUpload,ArBodyHandlerFunction onBody = NULL);
+  void begin() { _started = true; }
+  void end() { _started = false; }
+
+  //host side. body is delivered in one piece like a small request on the chip. 404 when no route matches
+  AsyncWebServerRequest handle(WebRequestMethodComposite method,const char *url,const char *body = NULL);
+};
+
+#endif
@@ -0,0 +1,37 @@
+#include <FS.h>
+#include <SPIFFS.h>
+
+fs::FS SPIFFS("data");
+
+namespace fs
+{
+
+bool FS::begin(bool formatOnFail,const char *basePath,uint8_t maxOpenFiles,const char *partitionLabel)
+{
+	const char *root = getenv("NATIVE_FS_ROOT");
+	if(root != NULL) _root = root;
+	return true;
+}
+
+bool FS::exists(const char *path)
+{
+	String content;
+	return readFile(path,content);
+}
+
+bool FS::readFile(const char *path,String &content)
+{
+	String full = _root + path;
+	FILE *file = fopen(full.c_str(),"rb");
+	if(file == NULL) return false;
+	char chunk[256];
+	size_t n;
+	content = "";
+	while((n = fread(chunk,1,sizeof(chunk),file)) > 0){
+		content.concat(chunk,n);
+	}
+	fclose(file);
+	return true;
+}
+
+}
@@ -0,0 +1,29 @@
+/* file system of host builds, maps to a directory on the host (NATIVE_FS_ROOT, default "data" like uploadfs) */
+
+#ifndef FS_h
+#define FS_h
+
+#include <Arduino.h>
+
+namespace fs
+{
+
+class FS
+{
+private:
+  String _root;
+
+public:
+  FS(const char *root) : _root(root) {}
+  bool begin(bool formatOnFail = false,const char *basePath = "/spiffs",uint8_t maxOpenFiles = 10,const char *partitionLabel = NULL);
+  void end() {}
+  bool exists(const char *path);
+  bool exists(const String &path) { return exists(path.c_str()); }
+  bool readFile(const char *path,String &content);		//host side, used by the web server stub
+};
+
+}
+
+using fs::FS;
+
+#endif
@@ -0,0 +1,96 @@
+#include <Arduino.h>
+#include <shim.h>
+#include <unistd.h>
+#include <string>
+
+HardwareSerial Serial;
+
+struct ScriptLine
+{
+	HardwareSerial *serial;
+	std::string text;
+	esp_timer_handle_t timer;
+};
+
+static void deliverLine(void *arg)
+{
+	ScriptLine *line = (ScriptLine *)arg;
+	line->serial->inject(line->text.c_str());
+	esp_timer_delete(line->timer);
+	delete line;
+}
+
+void HardwareSerial::loadScript()
+{
+	_scriptLoaded = true;
+	if(isatty(STDIN_FILENO)) return;
+	char buf[512];
+	while(fgets(buf,sizeof(buf),stdin) != NULL){
+		std::string text(buf);
+		if(text.empty() || text.back() != '\n') text += '\n';
+		unsigned long atMs = 0;
+		if(text[0] == '@'){
+			char *end;
+			atMs = strtoul(text.c_str() + 1,&end,10);
+			while(*end == ' ') end++;
+			text = end;
+		}
+		ScriptLine *line = new ScriptLine{this,text,NULL};
+		esp_timer_create_args_t args = {};
+		args.callback = deliverLine;
+		args.arg = line;
+		args.name = "serial";
+		esp_timer_create(&args,&line->timer);
+		esp_timer_start_once(line->timer,atMs * 1000ULL > shimNowUs() ? atMs * 1000ULL - shimNowUs() : 0);
+	}
+}
+
+void HardwareSerial::begin(unsigned long baud,uint32_t config,int8_t rxPin,int8_t txPin)
+{
+	if(!_scriptLoaded) loadScript();
+}
+
+int HardwareSerial::available()
+{
+	if(!_scriptLoaded) loadScript();
+	return _rx.size();
+}
+
+int HardwareSerial::read()
+{
+	if(_rx.empty()) return -1;
+	uint8_t c = _rx.front();
+	_rx.pop_front();
+	return c;
+}
+
+int HardwareSerial::peek()
+{
+	return _rx.empty() ? -1 : _rx.front();
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+	fputc(c,stdout);
+	return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer,size_t size)
+{
+	return fwrite(buffer,1,size,stdout);
+}
+
+void HardwareSerial::flush()
+{
+	fflush(stdout);
+}
+
+void HardwareSerial::inject(const uint8_t *data,size_t len)
+{
+	_rx.insert(_rx.end(),data,data + len);
+}
+
+void HardwareSerial::inject(const char *text)
+{
+	inject((const uint8_t *)text,strlen(text));
+}
@@ -0,0 +1,38 @@
+/* Serial of host builds. output goes to stdout. input comes from stdin when it is a file or pipe,
+	read at start as a script: "@<ms> text" lines arrive at that virtual time, other lines right away.
+		@0 status
+		@2500 freq 88.1
+*/
+
+#ifndef HardwareSerial_h
+#define HardwareSerial_h
+
+#include <Stream.h>
+#include <deque>
+
+class HardwareSerial : public Stream
+{
+private:
+  std::deque<uint8_t> _rx;
+  bool _scriptLoaded = false;
+  void loadScript();
+
+public:
+  void begin(unsigned long baud,uint32_t config = 0,int8_t rxPin = -1,int8_t txPin = -1);
+  void end() {}
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer,size_t size) override;
+  using Print::write;
+  void flush() override;
+  operator bool() const { return true; }
+
+  void inject(const uint8_t *data,size_t len);		//bytes arrive now, for tests
+  void inject(const char *text);
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,15 @@
+#include <I2CDevices.h>
+
+bool I2CRegisterFile::i2cWrite(const uint8_t *data,size_t len)
+{
+	if(len == 0) return true;
+	_pointer = data[0];
+	for(size_t i = 1; i < len; i++) _regs[_pointer++] = data[i];
+	return true;
+}
+
+size_t I2CRegisterFile::i2cRead(uint8_t *data,size_t len)
+{
+	for(size_t i = 0; i < len; i++) data[i] = _regs[_pointer++];
+	return len;
+}
@@ -0,0 +1,32 @@
+/* simple slaves for the simulated bus (see Wire.h) */
+
+#ifndef I2CDevices_h
+#define I2CDevices_h
+
+#include <Wire.h>
+
+/* register file with auto increment: first written byte selects the register, following bytes are written to
+	consecutive registers, reads continue from the selected register. enough for most sensors and radio chips.
+*/
+class I2CRegisterFile : public I2CDevice
+{
+protected:
+  uint8_t _regs[256] = {};
+  uint8_t _pointer = 0;
+
+public:
+  bool i2cWrite(const uint8_t *data,size_t len) override;
+  size_t i2cRead(uint8_t *data,size_t len) override;
+  uint8_t reg(uint8_t addr) const { return _regs[addr]; }
+  void setReg(uint8_t addr,uint8_t value) { _regs[addr] = value; }
+};
+
+/* ACKs and drops everything, e.g. a display nobody looks at */
+class I2CSink : public I2CDevice
+{
+public:
+  bool i2cWrite(const uint8_t *data,size_t len) override { return true; }
+  size_t i2cRead(uint8_t *data,size_t len) override { memset(data,0xFF,len); return len; }
+};
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef IPAddress_h
+#define IPAddress_h
+
+#include <stdint.h>
+#include <Printable.h>
+#include <WString.h>
+
+class IPAddress : public Printable
+{
+private:
+  uint8_t _address[4];
+
+public:
+  IPAddress() : _address{0, 0, 0, 0} {}
+  IPAddress(uint8_t a,uint8_t b,uint8_t c,uint8_t d) : _address{a, b, c, d} {}
+  uint8_t operator[](int index) const { return _address[index & 3]; }
+  bool operator==(const IPAddress &other) const;
+  bool operator!=(const IPAddress &other) const { return !(*this == other); }
+  String toString() const;
+  size_t printTo(Print &p) const override;
+};
+
+#endif
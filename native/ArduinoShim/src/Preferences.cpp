@@ -0,0 +1,123 @@
+#include <Preferences.h>
+#include <map>
+#include <string>
+#include <vector>
+
+typedef std::map<std::string,std::vector<uint8_t> > Namespace;
+
+static std::map<std::string,Namespace> &storage()
+{
+	static std::map<std::string,Namespace> namespaces;
+	return namespaces;
+}
+
+bool Preferences::begin(const char *name,bool readOnly,const char *partitionLabel)
+{
+	if(_open) return false;
+	_namespace = name;
+	_readOnly = readOnly;
+	_open = true;
+	return true;
+}
+
+void Preferences::end()
+{
+	_open = false;
+}
+
+bool Preferences::clear()
+{
+	if(!_open || _readOnly) return false;
+	storage()[_namespace.c_str()].clear();
+	return true;
+}
+
+bool Preferences::remove(const char *key)
+{
+	if(!_open || _readOnly) return false;
+	return storage()[_namespace.c_str()].erase(key) > 0;
+}
+
+bool Preferences::isKey(const char *key)
+{
+	if(!_open) return false;
+	Namespace &ns = storage()[_namespace.c_str()];
+	return ns.find(key) != ns.end();
+}
+
+bool Preferences::put(const char *key,const void *value,size_t len)
+{
+	if(!_open || _readOnly || strlen(key) > 15) return false;		//NVS keys are 15 characters at most
+	const uint8_t *bytes = (const uint8_t *)value;
+	storage()[_namespace.c_str()][key].assign(bytes,bytes + len);
+	return true;
+}
+
+/* copies stored value when it fits into maxLen, returns its length (0 when missing or too big) */
+size_t Preferences::get(const char *key,void *value,size_t maxLen)
+{
+	if(!_open) return 0;
+	Namespace &ns = storage()[_namespace.c_str()];
+	Namespace::iterator it = ns.find(key);
+	if(it == ns.end() || it->second.size() > maxLen) return 0;
+	memcpy(value,it->second.data(),it->second.size());
+	return it->second.size();
+}
+
+size_t Preferences::putString(const char *key,const String &value)
+{
+	return put(key,value.c_str(),value.length() + 1) ? value.length() : 0;
+}
+
+bool Preferences::getBool(const char *key,bool defaultValue)
+{
+	bool value = defaultValue;
+	return get(key,&value,sizeof(value)) == sizeof(value) ? value : defaultValue;
+}
+
+uint8_t Preferences::getUChar(const char *key,uint8_t defaultValue)
+{
+	uint8_t value;
+	return get(key,&value,sizeof(value)) == sizeof(value) ? value : defaultValue;
+}
+
+uint16_t Preferences::getUShort(const char *key,uint16_t defaultValue)
+{
+	uint16_t value;
+	return get(key,&value,sizeof(value)) == sizeof(value) ? value : defaultValue;
+}
+
+int32_t Preferences::getInt(const char *key,int32_t defaultValue)
+{
+	int32_t value;
+	return get(key,&value,sizeof(value)) == sizeof(value) ? value : defaultValue;
+}
+
+uint32_t Preferences::getUInt(const char *key,uint32_t defaultValue)
+{
+	uint32_t value;
+	return get(key,&value,sizeof(value)) == sizeof(value) ? value : defaultValue;
+}
+
+float Preferences::getFloat(const char *key,float defaultValue)
+{
+	float value;
+	return get(key,&value,sizeof(value)) == sizeof(value) ? value : defaultValue;
+}
+
+String Preferences::getString(const char *key,const String &defaultValue)
+{
+	if(!_open) return defaultValue;
+	Namespace &ns = storage()[_namespace.c_str()];
+	Namespace::iterator it = ns.find(key);
+	if(it == ns.end()) return defaultValue;
+	return String((const char *)it->second.data());
+}
+
+size_t Preferences::getBytesLength(const char *key)
+{
+	if(!_open) return 0;
+	Namespace &ns = storage()[_namespace.c_str()];
+	Namespace::iterator it = ns.find(key);
+	return it == ns.end() ? 0 : it->second.size();
+}
@@ -0,0 +1,47 @@
+/* Preferences of host builds. namespaces live in memory for the whole run, so save/load round trips
+	(fast boot from register image, settings survive soft reset) behave like NVS. nothing is written to disk.
+*/
+
+#ifndef Preferences_h
+#define Preferences_h
+
+#include <Arduino.h>
+
+class Preferences
+{
+private:
+  String _namespace;
+  bool _open = false;
+  bool _readOnly = false;
+
+  bool put(const char *key,const void *value,size_t len);
+  size_t get(const char *key,void *value,size_t maxLen);
+
+public:
+  bool begin(const char *name,bool readOnly = false,const char *partitionLabel = NULL);
+  void end();
+  bool clear();
+  bool remove(const char *key);
+  bool isKey(const char *key);
+
+  size_t putBool(const char *key,bool value) { return put(key,&value,sizeof(value)) ? sizeof(value) : 0; }
+  size_t putUChar(const char *key,uint8_t value) { return put(key,&value,sizeof(value)) ? sizeof(value) : 0; }
+  size_t putUShort(const char *key,uint16_t value) { return put(key,&value,sizeof(value)) ? sizeof(value) : 0; }
+  size_t putInt(const char *key,int32_t value) { return put(key,&value,sizeof(value)) ? sizeof(value) : 0; }
+  size_t putUInt(const char *key,uint32_t value) { return put(key,&value,sizeof(value)) ? sizeof(value) : 0; }
+  size_t putFloat(const char *key,float value) { return put(key,&value,sizeof(value)) ? sizeof(value) : 0; }
+  size_t putString(const char *key,const String &value);
+  size_t putBytes(const char *key,const void *value,size_t len) { return put(key,value,len) ? len : 0; }
+
+  bool getBool(const char *key,bool defaultValue = false);
+  uint8_t getUChar(const char *key,uint8_t defaultValue = 0);
+  uint16_t getUShort(const char *key,uint16_t defaultValue = 0);
+  int32_t getInt(const char *key,int32_t defaultValue = 0);
+  uint32_t getUInt(const char *key,uint32_t defaultValue = 0);
+  float getFloat(const char *key,float defaultValue = NAN);
+  String getString(const char *key,const String &defaultValue = String());
+  size_t getBytesLength(const char *key);
+  size_t getBytes(const char *key,void *buf,size_t maxLen) { return get(key,buf,maxLen); }
+};
+
+#endif
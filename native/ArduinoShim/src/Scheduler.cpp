@@ -0,0 +1,666 @@
+/*
+FreeRTOS and esp_timer for host builds, on a virtual clock.
+
+every task is a std::thread, but only the task in `current` is allowed to run, all others wait on their
+condition variable. so code runs exactly as on the single core ESP32-C3: the highest priority ready task runs,
+a task that readies a higher priority one (queue send, notify, mutex give) is preempted right there,
+equal priorities are served in the order they became ready.
+
+time never passes while a task runs, it only moves forward when
+	- no task is ready: clock jumps to the next timeout or timer (delay, vTaskDelay, queue timeout, esp_timer ...)
+	- a task calls shimSleepUs() (I2C transfer) or shimBusyUs() (delayMicroseconds)
+so a run is deterministic and independent of host speed, 10 minutes of firmware time take a few seconds.
+
+tick is 1 ms. vTaskDelay() wakes on a tick boundary like the real tick interrupt does, everything else
+(esp_timer, shimSleepUs) has microsecond resolution.
+
+the thread calling the first API function becomes "loopTask" with priority 1, like setup()/loop() on the chip.
+*/
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <esp_timer.h>
+#include <shim.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define 		NO_TIMEOUT			  UINT64_MAX
+#define 		LOOP_TASK_PRIORITY	  1
+
+enum TaskState { TASK_READY, TASK_BLOCKED, TASK_DELETED };
+enum WaitKind { WAIT_NONE, WAIT_SLEEP, WAIT_NOTIFY, WAIT_RECEIVE, WAIT_SEND, WAIT_SEMAPHORE };
+
+struct ShimTask
+{
+	const char *name;
+	uint32_t stackDepth = 0;
+	UBaseType_t basePriority;
+	UBaseType_t priority;			//raised while holding a mutex a higher priority task waits for
+	uint8_t mutexesHeld = 0;
+	TaskState state = TASK_READY;
+	uint64_t readySeq = 0;			//order tasks of same priority became ready
+	uint64_t wakeUs = NO_TIMEOUT;
+	bool timedOut = false;
+	WaitKind waitKind = WAIT_NONE;
+	const void *waitingOn = NULL;
+	uint32_t notifyValue = 0;
+	TaskFunction_t fn = NULL;
+	void *param = NULL;
+	std::condition_variable_any cv;
+};
+
+struct ShimQueue
+{
+	UBaseType_t length;
+	UBaseType_t itemSize;
+	std::deque<std::vector<uint8_t> > items;
+};
+
+struct ShimSemaphore
+{
+	bool mutex;
+	UBaseType_t count;
+	UBaseType_t maxCount;
+	ShimTask *holder;
+};
+
+struct ShimTimer
+{
+	esp_timer_cb_t callback;
+	void *arg;
+	bool active;
+	uint64_t dueUs;
+	uint64_t periodUs;				//0 == one shot
+};
+
+static std::recursive_mutex lock;
+static std::vector<ShimTask *> tasks;
+static std::vector<ShimTimer *> timers;
+static ShimTask *current = NULL;
+static uint64_t nowUs = 0;
+static uint64_t readyCounter = 0;
+static uint64_t runLimitUs = 0;
+static bool dispatching = false;		//timer callbacks and timeouts running, no task switch now
+static ShimExitHook exitHook = NULL;
+
+typedef std::unique_lock<std::recursive_mutex> Guard;
+
+static void ensureInit()
+{
+	if(current != NULL) return;
+	ShimTask *t = new ShimTask();
+	t->name = "loopTask";
+	t->basePriority = t->priority = LOOP_TASK_PRIORITY;
+	t->readySeq = ++readyCounter;
+	tasks.push_back(t);
+	current = t;
+}
+
+static void makeReady(ShimTask *t)
+{
+	t->state = TASK_READY;
+	t->waitKind = WAIT_NONE;
+	t->waitingOn = NULL;
+	t->wakeUs = NO_TIMEOUT;
+	t->readySeq = ++readyCounter;
+}
+
+static ShimTask *pickReady()
+{
+	ShimTask *best = NULL;
+	for(ShimTask *t : tasks){
+		if(t->state != TASK_READY) continue;
+		if(best == NULL || t->priority > best->priority ||
+			(t->priority == best->priority && t->readySeq < best->readySeq)) best = t;
+	}
+	return best;
+}
+
+static uint64_t nextEventUs()
+{
+	uint64_t next = NO_TIMEOUT;
+	for(ShimTask *t : tasks){
+		if(t->state == TASK_BLOCKED && t->wakeUs < next) next = t->wakeUs;
+	}
+	for(ShimTimer *tm : timers){
+		if(tm->active && tm->dueUs < next) next = tm->dueUs;
+	}
+	return next;
+}
+
+/* run expired timers and wake tasks whose timeout passed, in time order */
+static void fireDue()
+{
+	dispatching = true;
+	for(;;){
+		ShimTimer *due = NULL;
+		for(ShimTimer *tm : timers){
+			if(tm->active && tm->dueUs <= nowUs && (due == NULL || tm->dueUs < due->dueUs)) due = tm;
+		}
+		if(due == NULL) break;
+		if(due->periodUs){
+			due->dueUs += due->periodUs;
+		}else{
+			due->active = false;
+		}
+		due->callback(due->arg);
+	}
+	for(ShimTask *t : tasks){
+		if(t->state == TASK_BLOCKED && t->wakeUs <= nowUs){
+			makeReady(t);
+			t->timedOut = true;
+		}
+	}
+	dispatching = false;
+}
+
+void shimExit(int status)
+{
+	if(exitHook != NULL){
+		ShimExitHook hook = exitHook;
+		exitHook = NULL;
+		hook();
+	}
+	fflush(stdout);
+	fflush(stderr);
+	_Exit(status);
+}
+
+static void advanceTo(uint64_t us)
+{
+	if(runLimitUs && us > runLimitUs){
+		nowUs = runLimitUs;
+		shimExit(0);
+	}
+	if(us > nowUs) nowUs = us;
+	fireDue();
+}
+
+/* give CPU to the best ready task and come back when this task is picked again */
+static void reschedule(Guard &guard)
+{
+	ShimTask *self = current;
+	for(;;){
+		ShimTask *next = pickReady();
+		if(next != NULL){
+			if(next != self){
+				current = next;
+				next->cv.notify_all();
+			}
+			break;
+		}
+		uint64_t next_us = nextEventUs();
+		if(next_us == NO_TIMEOUT){
+			fprintf(stderr,"[shim] all tasks blocked for ever at %llu us\n",(unsigned long long)nowUs);
+			shimExit(runLimitUs ? 1 : 0);
+		}
+		advanceTo(next_us);
+	}
+	while(current != self || self->state == TASK_DELETED) self->cv.wait(guard);
+}
+
+/* running task readied someone, switch if that one has higher priority */
+static void preemptIfNeeded(Guard &guard)
+{
+	if(dispatching) return;
+	ShimTask *best = pickReady();
+	if(best != NULL && best != current && best->priority > current->priority) reschedule(guard);
+}
+
+/* block running task until woken or deadlineUs. returns false on timeout */
+static bool blockCurrent(Guard &guard,uint64_t deadlineUs,WaitKind kind,const void *on)
+{
+	ShimTask *self = current;
+	self->state = TASK_BLOCKED;
+	self->wakeUs = deadlineUs;
+	self->waitKind = kind;
+	self->waitingOn = on;
+	self->timedOut = false;
+	reschedule(guard);
+	return !self->timedOut;
+}
+
+/* highest priority task waiting for `on`, longest waiting first */
+static ShimTask *firstWaiter(WaitKind kind,const void *on)
+{
+	ShimTask *best = NULL;
+	for(ShimTask *t : tasks){
+		if(t->state != TASK_BLOCKED || t->waitKind != kind || t->waitingOn != on) continue;
+		if(best == NULL || t->priority > best->priority) best = t;
+	}
+	return best;
+}
+
+static uint64_t deadlineFor(TickType_t ticks)
+{
+	if(ticks == portMAX_DELAY) return NO_TIMEOUT;
+	return nowUs + (uint64_t)ticks * 1000000ULL / configTICK_RATE_HZ;
+}
+
+//------------------------------clock-------------------------------------------------------
+
+uint64_t shimNowUs()
+{
+	return nowUs;
+}
+
+void shimSetRunLimitMs(uint64_t ms)
+{
+	runLimitUs = ms * 1000ULL;
+}
+
+void shimOnExit(ShimExitHook hook)
+{
+	exitHook = hook;
+}
+
+void shimSleepUs(uint32_t us)
+{
+	Guard guard(lock);
+	ensureInit();
+	if(us == 0) return;
+	blockCurrent(guard,nowUs + us,WAIT_SLEEP,NULL);
+}
+
+void shimBusyUs(uint32_t us)
+{
+	Guard guard(lock);
+	ensureInit();
+	uint64_t target = nowUs + us;
+	for(;;){
+		uint64_t next = nextEventUs();
+		if(next > target) break;
+		advanceTo(next);
+		preemptIfNeeded(guard);
+	}
+	if(target > nowUs) advanceTo(target);
+}
+
+int64_t esp_timer_get_time()
+{
+	return (int64_t)nowUs;
+}
+
+//------------------------------tasks-------------------------------------------------------
+
+static void taskEntry(ShimTask *t)
+{
+	Guard guard(lock);
+	while(current != t) t->cv.wait(guard);
+	guard.unlock();
+	t->fn(t->param);
+	fprintf(stderr,"[shim] task %s returned, tasks must call vTaskDelete(NULL)\n",t->name);
+	vTaskDelete(NULL);
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn,const char *name,uint32_t stackDepth,void *param,UBaseType_t priority,TaskHandle_t *handle)
+{
+	Guard guard(lock);
+	ensureInit();
+	ShimTask *t = new ShimTask();
+	t->name = name;
+	t->stackDepth = stackDepth;
+	t->basePriority = t->priority = priority;
+	t->fn = fn;
+	t->param = param;
+	makeReady(t);
+	tasks.push_back(t);
+	if(handle != NULL) *handle = t;
+	std::thread(taskEntry,t).detach();
+	preemptIfNeeded(guard);
+	return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn,const char *name,uint32_t stackDepth,void *param,UBaseType_t priority,TaskHandle_t *handle,BaseType_t core)
+{
+	return xTaskCreate(fn,name,stackDepth,param,priority,handle);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+	Guard guard(lock);
+	ensureInit();
+	ShimTask *t = task != NULL ? task : current;
+	t->state = TASK_DELETED;
+	if(t == current) reschedule(guard);		//never returns, thread stays parked
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+	Guard guard(lock);
+	ensureInit();
+	if(ticks == 0){
+		current->readySeq = ++readyCounter;
+		reschedule(guard);
+		return;
+	}
+	uint64_t tickUs = 1000000ULL / configTICK_RATE_HZ;
+	blockCurrent(guard,(nowUs / tickUs + ticks) * tickUs,WAIT_SLEEP,NULL);
+}
+
+void vTaskDelayUntil(TickType_t *previousWake,TickType_t increment)
+{
+	Guard guard(lock);
+	ensureInit();
+	uint64_t tickUs = 1000000ULL / configTICK_RATE_HZ;
+	*previousWake += increment;
+	uint64_t wakeUs = (uint64_t)*previousWake * tickUs;
+	if(wakeUs > nowUs) blockCurrent(guard,wakeUs,WAIT_SLEEP,NULL);
+}
+
+TickType_t xTaskGetTickCount()
+{
+	return (TickType_t)(nowUs * configTICK_RATE_HZ / 1000000ULL);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+	Guard guard(lock);
+	ensureInit();
+	return current;
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task)
+{
+	Guard guard(lock);
+	ensureInit();
+	return (task != NULL ? task : current)->priority;
+}
+
+const char *pcTaskGetName(TaskHandle_t task)
+{
+	Guard guard(lock);
+	ensureInit();
+	return (task != NULL ? task : current)->name;
+}
+
+/* host threads have their own big stacks, so there is nothing to measure. reports the whole stack as unused */
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+	Guard guard(lock);
+	ensureInit();
+	return (task != NULL ? task : current)->stackDepth;
+}
+
+void taskYIELD()
+{
+	Guard guard(lock);
+	ensureInit();
+	current->readySeq = ++readyCounter;		//behind other ready tasks of same priority
+	reschedule(guard);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+	Guard guard(lock);
+	ensureInit();
+	task->notifyValue++;
+	if(task->state == TASK_BLOCKED && task->waitKind == WAIT_NOTIFY){
+		makeReady(task);
+		preemptIfNeeded(guard);
+	}
+	return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit,TickType_t ticksToWait)
+{
+	Guard guard(lock);
+	ensureInit();
+	ShimTask *self = current;
+	if(self->notifyValue == 0 && ticksToWait != 0){
+		blockCurrent(guard,deadlineFor(ticksToWait),WAIT_NOTIFY,NULL);
+	}
+	uint32_t value = self->notifyValue;
+	if(value) self->notifyValue = clearOnExit ? 0 : value - 1;
+	return value;
+}
+
+//------------------------------queues------------------------------------------------------
+
+QueueHandle_t xQueueCreate(UBaseType_t length,UBaseType_t itemSize)
+{
+	ShimQueue *q = new ShimQueue();
+	q->length = length;
+	q->itemSize = itemSize;
+	return q;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+	delete queue;
+}
+
+static BaseType_t queueSend(QueueHandle_t q,const void *item,TickType_t ticksToWait,bool front,bool overwrite)
+{
+	Guard guard(lock);
+	ensureInit();
+	uint64_t deadline = deadlineFor(ticksToWait);
+	while(!overwrite && q->items.size() >= q->length){
+		if(ticksToWait == 0 || !blockCurrent(guard,deadline,WAIT_SEND,q)) return errQUEUE_FULL;
+	}
+	std::vector<uint8_t> data((const uint8_t *)item,(const uint8_t *)item + q->itemSize);
+	if(overwrite && !q->items.empty()){
+		q->items.back() = data;
+	}else if(front){
+		q->items.push_front(data);
+	}else{
+		q->items.push_back(data);
+	}
+	ShimTask *waiter = firstWaiter(WAIT_RECEIVE,q);
+	if(waiter != NULL){
+		makeReady(waiter);
+		preemptIfNeeded(guard);
+	}
+	return pdPASS;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue,const void *item,TickType_t ticksToWait)
+{
+	return queueSend(queue,item,ticksToWait,false,false);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue,const void *item,TickType_t ticksToWait)
+{
+	return queueSend(queue,item,ticksToWait,false,false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue,const void *item,TickType_t ticksToWait)
+{
+	return queueSend(queue,item,ticksToWait,true,false);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue,const void *item)
+{
+	return queueSend(queue,item,0,false,true);
+}
+
+static BaseType_t queueReceive(QueueHandle_t q,void *item,TickType_t ticksToWait,bool peek)
+{
+	Guard guard(lock);
+	ensureInit();
+	uint64_t deadline = deadlineFor(ticksToWait);
+	while(q->items.empty()){
+		if(ticksToWait == 0 || !blockCurrent(guard,deadline,WAIT_RECEIVE,q)) return pdFALSE;
+	}
+	memcpy(item,q->items.front().data(),q->itemSize);
+	if(peek){
+		//another receiver may take it as well
+		ShimTask *waiter = firstWaiter(WAIT_RECEIVE,q);
+		if(waiter != NULL) makeReady(waiter);
+		return pdTRUE;
+	}
+	q->items.pop_front();
+	ShimTask *waiter = firstWaiter(WAIT_SEND,q);
+	if(waiter != NULL){
+		makeReady(waiter);
+		preemptIfNeeded(guard);
+	}
+	return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue,void *item,TickType_t ticksToWait)
+{
+	return queueReceive(queue,item,ticksToWait,false);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue,void *item,TickType_t ticksToWait)
+{
+	return queueReceive(queue,item,ticksToWait,true);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+	Guard guard(lock);
+	return queue->items.size();
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue)
+{
+	Guard guard(lock);
+	queue->items.clear();
+	return pdPASS;
+}
+
+//------------------------------semaphores--------------------------------------------------
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+	ShimSemaphore *s = new ShimSemaphore();
+	s->mutex = true;
+	s->count = s->maxCount = 1;
+	s->holder = NULL;
+	return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+	return xSemaphoreCreateCounting(1,0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount,UBaseType_t initialCount)
+{
+	ShimSemaphore *s = new ShimSemaphore();
+	s->mutex = false;
+	s->count = initialCount;
+	s->maxCount = maxCount;
+	s->holder = NULL;
+	return s;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+	delete sem;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s,TickType_t ticksToWait)
+{
+	Guard guard(lock);
+	ensureInit();
+	uint64_t deadline = deadlineFor(ticksToWait);
+	while(s->count == 0){
+		if(ticksToWait == 0) return pdFALSE;
+		//priority inheritance: holder runs at our priority until it gives the mutex back
+		if(s->mutex && s->holder != NULL && s->holder->priority < current->priority){
+			s->holder->priority = current->priority;
+		}
+		if(!blockCurrent(guard,deadline,WAIT_SEMAPHORE,s)) return pdFALSE;
+	}
+	s->count--;
+	if(s->mutex){
+		s->holder = current;
+		current->mutexesHeld++;
+	}
+	return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s)
+{
+	Guard guard(lock);
+	ensureInit();
+	if(s->mutex){
+		if(s->holder != current) return pdFALSE;
+		s->holder = NULL;
+		//like FreeRTOS, inherited priority is dropped only when no mutex is held anymore
+		if(--current->mutexesHeld == 0) current->priority = current->basePriority;
+	}else if(s->count >= s->maxCount){
+		return pdFALSE;
+	}
+	s->count++;
+	ShimTask *waiter = firstWaiter(WAIT_SEMAPHORE,s);
+	if(waiter != NULL) makeReady(waiter);
+	preemptIfNeeded(guard);
+	return pdTRUE;
+}
+
+TaskHandle_t xSemaphoreGetMutexHolder(SemaphoreHandle_t sem)
+{
+	Guard guard(lock);
+	return sem->holder;
+}
+
+//------------------------------esp_timer---------------------------------------------------
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args,esp_timer_handle_t *handle)
+{
+	if(args == NULL || args->callback == NULL || handle == NULL) return ESP_ERR_INVALID_ARG;
+	Guard guard(lock);
+	ShimTimer *tm = new ShimTimer();
+	tm->callback = args->callback;
+	tm->arg = args->arg;
+	tm->active = false;
+	tm->dueUs = 0;
+	tm->periodUs = 0;
+	timers.push_back(tm);
+	*handle = tm;
+	return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer,uint64_t timeoutUs)
+{
+	Guard guard(lock);
+	if(timer->active) return ESP_ERR_INVALID_STATE;
+	timer->active = true;
+	timer->dueUs = nowUs + timeoutUs;
+	timer->periodUs = 0;
+	return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer,uint64_t periodUs)
+{
+	Guard guard(lock);
+	if(timer->active) return ESP_ERR_INVALID_STATE;
+	timer->active = true;
+	timer->dueUs = nowUs + periodUs;
+	timer->periodUs = periodUs;
+	return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+	Guard guard(lock);
+	if(!timer->active) return ESP_ERR_INVALID_STATE;
+	timer->active = false;
+	return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+	Guard guard(lock);
+	for(size_t i = 0; i < timers.size(); i++){
+		if(timers[i] == timer){
+			timers.erase(timers.begin() + i);
+			break;
+		}
+	}
+	delete timer;
+	return ESP_OK;
+}
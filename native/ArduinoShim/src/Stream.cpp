@@ -0,0 +1,34 @@
+#include <Arduino.h>
+
+int Stream::timedRead()
+{
+	unsigned long start = millis();
+	do{
+		int c = read();
+		if(c >= 0) return c;
+		delay(1);
+	}while(millis() - start < _timeoutMs);
+	return -1;
+}
+
+String Stream::readStringUntil(char terminator)
+{
+	String s;
+	int c = timedRead();
+	while(c >= 0 && c != terminator){
+		s += (char)c;
+		c = timedRead();
+	}
+	return s;
+}
+
+size_t Stream::readBytes(uint8_t *buffer,size_t length)
+{
+	size_t n = 0;
+	while(n < length){
+		int c = timedRead();
+		if(c < 0) break;
+		buffer[n++] = c;
+	}
+	return n;
+}
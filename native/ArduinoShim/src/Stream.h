@@ -0,0 +1,22 @@
+#ifndef Stream_h
+#define Stream_h
+
+#include <Print.h>
+
+class Stream : public Print
+{
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  void setTimeout(unsigned long timeoutMs) { _timeoutMs = timeoutMs; }
+  String readStringUntil(char terminator);
+  size_t readBytes(uint8_t *buffer,size_t length);
+  size_t readBytes(char *buffer,size_t length) { return readBytes((uint8_t *)buffer,length); }
+
+protected:
+  unsigned long _timeoutMs = 1000;
+  int timedRead();
+};
+
+#endif
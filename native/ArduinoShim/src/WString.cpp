@@ -0,0 +1,192 @@
+#include <WString.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <string.h>
+
+static std::string toBase(unsigned long long value,unsigned char base,bool negative)
+{
+	if(base < 2 || base > 36) base = 10;
+	char buf[72];
+	int i = sizeof(buf) - 1;
+	buf[i] = '\0';
+	do{
+		uint8_t digit = value % base;
+		buf[--i] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+		value /= base;
+	}while(value);
+	if(negative) buf[--i] = '-';
+	return std::string(buf + i);
+}
+
+static std::string signedToBase(long long value,unsigned char base)
+{
+	if(base == 10 && value < 0) return toBase(-(unsigned long long)value,base,true);
+	return toBase((unsigned long long)value,base,false);
+}
+
+static std::string floatToString(double value,unsigned char decimalPlaces)
+{
+	char buf[64];
+	snprintf(buf,sizeof(buf),"%.*f",decimalPlaces,value);
+	return std::string(buf);
+}
+
+String::String(const char *cstr) : _s(cstr != NULL ? cstr : "") {}
+String::String(const char *cstr,size_t len) : _s(cstr,len) {}
+String::String(const std::string &s) : _s(s) {}
+String::String(char c) : _s(1,c) {}
+String::String(unsigned char value,unsigned char base) : _s(toBase(value,base,false)) {}
+String::String(int value,unsigned char base) : _s(base == 10 ? signedToBase(value,base) : toBase((unsigned int)value,base,false)) {}
+String::String(unsigned int value,unsigned char base) : _s(toBase(value,base,false)) {}
+String::String(long value,unsigned char base) : _s(base == 10 ? signedToBase(value,base) : toBase((unsigned long)value,base,false)) {}
+String::String(unsigned long value,unsigned char base) : _s(toBase(value,base,false)) {}
+String::String(long long value,unsigned char base) : _s(signedToBase(value,base)) {}
+String::String(unsigned long long value,unsigned char base) : _s(toBase(value,base,false)) {}
+String::String(float value,unsigned char decimalPlaces) : _s(floatToString(value,decimalPlaces)) {}
+String::String(double value,unsigned char decimalPlaces) : _s(floatToString(value,decimalPlaces)) {}
+
+bool String::reserve(unsigned int size)
+{
+	_s.reserve(size);
+	return true;
+}
+
+String &String::operator=(const char *cstr)
+{
+	_s = cstr != NULL ? cstr : "";
+	return *this;
+}
+
+String &String::operator+=(const String &rhs) { _s += rhs._s; return *this; }
+String &String::operator+=(const char *cstr) { if(cstr != NULL) _s += cstr; return *this; }
+String &String::operator+=(char c) { _s += c; return *this; }
+bool String::concat(const String &s) { _s += s._s; return true; }
+bool String::concat(const char *cstr) { if(cstr != NULL) _s += cstr; return true; }
+bool String::concat(const char *cstr,unsigned int length) { if(cstr != NULL) _s.append(cstr,length); return true; }
+bool String::concat(char c) { _s += c; return true; }
+bool String::concat(int value) { _s += String(value)._s; return true; }
+bool String::concat(unsigned int value) { _s += String(value)._s; return true; }
+bool String::concat(long value) { _s += String(value)._s; return true; }
+bool String::concat(unsigned long value) { _s += String(value)._s; return true; }
+
+bool String::startsWith(const String &prefix) const
+{
+	return _s.compare(0,prefix._s.length(),prefix._s) == 0;
+}
+
+bool String::endsWith(const String &suffix) const
+{
+	return _s.length() >= suffix._s.length() &&
+		_s.compare(_s.length() - suffix._s.length(),suffix._s.length(),suffix._s) == 0;
+}
+
+char String::charAt(unsigned int index) const
+{
+	return index < _s.length() ? _s[index] : 0;
+}
+
+char &String::operator[](unsigned int index)
+{
+	static char dummy;
+	if(index >= _s.length()){
+		dummy = 0;
+		return dummy;
+	}
+	return _s[index];
+}
+
+void String::getBytes(unsigned char *buf,unsigned int bufsize,unsigned int index) const
+{
+	if(bufsize == 0) return;
+	unsigned int n = 0;
+	if(index < _s.length()){
+		n = std::min((unsigned int)_s.length() - index,bufsize - 1);
+		memcpy(buf,_s.data() + index,n);
+	}
+	buf[n] = 0;
+}
+
+void String::toCharArray(char *buf,unsigned int bufsize,unsigned int index) const
+{
+	getBytes((unsigned char *)buf,bufsize,index);
+}
+
+int String::indexOf(char ch,unsigned int fromIndex) const
+{
+	size_t pos = _s.find(ch,fromIndex);
+	return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String &s,unsigned int fromIndex) const
+{
+	size_t pos = _s.find(s._s,fromIndex);
+	return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char ch) const
+{
+	size_t pos = _s.rfind(ch);
+	return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int beginIndex) const
+{
+	return substring(beginIndex,_s.length());
+}
+
+String String::substring(unsigned int beginIndex,unsigned int endIndex) const
+{
+	if(beginIndex > endIndex) std::swap(beginIndex,endIndex);
+	if(beginIndex >= _s.length()) return String();
+	if(endIndex > _s.length()) endIndex = _s.length();
+	return String(_s.substr(beginIndex,endIndex - beginIndex));
+}
+
+void String::replace(const String &find,const String &replace)
+{
+	if(find._s.empty()) return;
+	size_t pos = 0;
+	while((pos = _s.find(find._s,pos)) != std::string::npos){
+		_s.replace(pos,find._s.length(),replace._s);
+		pos += replace._s.length();
+	}
+}
+
+void String::remove(unsigned int index)
+{
+	if(index < _s.length()) _s.erase(index);
+}
+
+void String::remove(unsigned int index,unsigned int count)
+{
+	if(index < _s.length()) _s.erase(index,count);
+}
+
+void String::toLowerCase()
+{
+	for(char &c : _s) c = tolower((unsigned char)c);
+}
+
+void String::toUpperCase()
+{
+	for(char &c : _s) c = toupper((unsigned char)c);
+}
+
+void String::trim()
+{
+	size_t begin = 0;
+	while(begin < _s.length() && isspace((unsigned char)_s[begin])) begin++;
+	size_t end = _s.length();
+	while(end > begin && isspace((unsigned char)_s[end - 1])) end--;
+	_s = _s.substr(begin,end - begin);
+}
+
+long String::toInt() const { return atol(_s.c_str()); }
+float String::toFloat() const { return atof(_s.c_str()); }
+double String::toDouble() const { return atof(_s.c_str()); }
+
+String operator+(const String &lhs,const String &rhs) { return String(lhs._s + rhs._s); }
+String operator+(const String &lhs,const char *rhs) { return String(lhs._s + (rhs != NULL ? rhs : "")); }
+String operator+(const char *lhs,const String &rhs) { return String((lhs != NULL ? lhs : "") + rhs._s); }
+String operator+(const String &lhs,char rhs) { return String(lhs._s + rhs); }
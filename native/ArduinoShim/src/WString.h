@@ -0,0 +1,86 @@
+/* Arduino String on top of std::string */
+
+#ifndef WString_h
+#define WString_h
+
+#include <stdint.h>
+#include <string>
+
+class String
+{
+private:
+  std::string _s;
+
+public:
+  String(const char *cstr = "");
+  String(const char *cstr,size_t len);
+  String(const std::string &s);
+  explicit String(char c);
+  explicit String(unsigned char value,unsigned char base = 10);
+  explicit String(int value,unsigned char base = 10);
+  explicit String(unsigned int value,unsigned char base = 10);
+  explicit String(long value,unsigned char base = 10);
+  explicit String(unsigned long value,unsigned char base = 10);
+  explicit String(long long value,unsigned char base = 10);
+  explicit String(unsigned long long value,unsigned char base = 10);
+  explicit String(float value,unsigned char decimalPlaces = 2);
+  explicit String(double value,unsigned char decimalPlaces = 2);
+
+  unsigned int length() const { return _s.length(); }
+  size_t size() const { return _s.size(); }		//for ArduinoJson, unsigned int is narrower than size_t on the host
+  bool isEmpty() const { return _s.empty(); }
+  const char *c_str() const { return _s.c_str(); }
+  bool reserve(unsigned int size);
+
+  String &operator=(const char *cstr);
+  String &operator+=(const String &rhs);
+  String &operator+=(const char *cstr);
+  String &operator+=(char c);
+  bool concat(const String &s);
+  bool concat(const char *cstr);
+  bool concat(const char *cstr,unsigned int length);
+  bool concat(char c);
+  bool concat(int value);
+  bool concat(unsigned int value);
+  bool concat(long value);
+  bool concat(unsigned long value);
+
+  bool equals(const String &s) const { return _s == s._s; }
+  bool equals(const char *cstr) const { return _s == cstr; }
+  bool operator==(const String &rhs) const { return equals(rhs); }
+  bool operator==(const char *cstr) const { return equals(cstr); }
+  bool operator!=(const String &rhs) const { return !equals(rhs); }
+  bool operator!=(const char *cstr) const { return !equals(cstr); }
+  bool startsWith(const String &prefix) const;
+  bool endsWith(const String &suffix) const;
+
+  char charAt(unsigned int index) const;
+  char operator[](unsigned int index) const { return charAt(index); }
+  char &operator[](unsigned int index);
+  void getBytes(unsigned char *buf,unsigned int bufsize,unsigned int index = 0) const;
+  void toCharArray(char *buf,unsigned int bufsize,unsigned int index = 0) const;
+
+  int indexOf(char ch,unsigned int fromIndex = 0) const;
+  int indexOf(const String &s,unsigned int fromIndex = 0) const;
+  int lastIndexOf(char ch) const;
+  String substring(unsigned int beginIndex) const;
+  String substring(unsigned int beginIndex,unsigned int endIndex) const;
+
+  void replace(const String &find,const String &replace);
+  void remove(unsigned int index);
+  void remove(unsigned int index,unsigned int count);
+  void toLowerCase();
+  void toUpperCase();
+  void trim();
+
+  long toInt() const;
+  float toFloat() const;
+  double toDouble() const;
+
+  friend String operator+(const String &lhs,const String &rhs);
+  friend String operator+(const String &lhs,const char *rhs);
+  friend String operator+(const char *lhs,const String &rhs);
+  friend String operator+(const String &lhs,char rhs);
+};
+
+#endif
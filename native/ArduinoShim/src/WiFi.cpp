@@ -0,0 +1,106 @@
+#include <WiFi.h>
+
+WiFiClass WiFi;
+
+bool IPAddress::operator==(const IPAddress &other) const
+{
+	return memcmp(_address,other._address,4) == 0;
+}
+
+String IPAddress::toString() const
+{
+	char text[16];
+	snprintf(text,sizeof(text),"%u.%u.%u.%u",_address[0],_address[1],_address[2],_address[3]);
+	return String(text);
+}
+
+size_t IPAddress::printTo(Print &p) const
+{
+	return p.print(toString());
+}
+
+void WiFiClass::onEvent(WiFiEventCb callback)
+{
+	for(uint8_t i = 0; i < WIFI_MAX_EVENT_CB; i++){
+		if(_callbacks[i] == NULL){
+			_callbacks[i] = callback;
+			return;
+		}
+	}
+}
+
+void WiFiClass::emit(WiFiEvent_t event)
+{
+	if(event == ARDUINO_EVENT_WIFI_STA_GOT_IP) _status = WL_CONNECTED;
+	if(event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED || event == ARDUINO_EVENT_WIFI_STA_LOST_IP) _status = WL_DISCONNECTED;
+	for(uint8_t i = 0; i < WIFI_MAX_EVENT_CB; i++){
+		if(_callbacks[i] != NULL) _callbacks[i](event);
+	}
+}
+
+void WiFiClass::connectDone(void *arg)
+{
+	WiFiClass *wifi = (WiFiClass *)arg;
+	wifi->emit(ARDUINO_EVENT_WIFI_STA_CONNECTED);
+	wifi->emit(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+}
+
+bool WiFiClass::mode(wifi_mode_t mode)
+{
+	_mode = mode;
+	return true;
+}
+
+wl_status_t WiFiClass::begin(const char *ssid,const char *passphrase)
+{
+	if(!(_mode & WIFI_STA)) _mode = (wifi_mode_t)(_mode | WIFI_STA);
+	_status = WL_DISCONNECTED;
+	const char *setting = getenv("NATIVE_WIFI_CONNECT_MS");
+	if(setting != NULL && strcmp(setting,"never") == 0) return _status;
+	uint32_t connectMs = setting != NULL ? strtoul(setting,NULL,10) : 1500;
+
+	if(_connectTimer == NULL){
+		esp_timer_create_args_t args = {};
+		args.callback = connectDone;
+		args.arg = this;
+		args.name = "wifi_connect";
+		esp_timer_create(&args,&_connectTimer);
+	}
+	esp_timer_stop(_connectTimer);
+	esp_timer_start_once(_connectTimer,(uint64_t)connectMs * 1000);
+	return _status;
+}
+
+bool WiFiClass::disconnect(bool wifiOff)
+{
+	if(_connectTimer != NULL) esp_timer_stop(_connectTimer);
+	bool wasConnected = _status == WL_CONNECTED;
+	_status = WL_DISCONNECTED;
+	if(wasConnected) emit(ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+	if(wifiOff) _mode = WIFI_OFF;
+	return true;
+}
+
+bool WiFiClass::softAP(const char *ssid,const char *passphrase)
+{
+	_mode = (wifi_mode_t)(_mode | WIFI_AP);
+	_apActive = true;
+	return true;
+}
+
+bool WiFiClass::softAPdisconnect(bool wifiOff)
+{
+	_apActive = false;
+	_mode = (wifi_mode_t)(_mode & ~WIFI_AP);
+	return true;
+}
+
+IPAddress WiFiClass::localIP()
+{
+	return _status == WL_CONNECTED ? IPAddress(192, 168, 1, 50) : IPAddress();
+}
+
+IPAddress WiFiClass::softAPIP()
+{
+	return _apActive ? IPAddress(192, 168, 4, 1) : IPAddress();
+}
@@ -0,0 +1,71 @@
+/* WiFi of host builds. there is no network, begin() just reports the connection through onEvent() after
+	NATIVE_WIFI_CONNECT_MS of virtual time (default 1500, "never" keeps station disconnected), so
+	reconnect and AP fallback logic run like on the chip.
+*/
+
+#ifndef WiFi_h
+#define WiFi_h
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+typedef enum {
+  WIFI_OFF = 0,
+  WIFI_STA = 1,
+  WIFI_AP = 2,
+  WIFI_AP_STA = 3
+} wifi_mode_t;
+
+typedef enum {
+  ARDUINO_EVENT_WIFI_READY = 0,
+  ARDUINO_EVENT_WIFI_STA_START,
+  ARDUINO_EVENT_WIFI_STA_STOP,
+  ARDUINO_EVENT_WIFI_STA_CONNECTED,
+  ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+  ARDUINO_EVENT_WIFI_STA_GOT_IP,
+  ARDUINO_EVENT_WIFI_STA_LOST_IP,
+  ARDUINO_EVENT_WIFI_AP_START,
+  ARDUINO_EVENT_WIFI_AP_STOP
+} arduino_event_id_t;
+
+typedef arduino_event_id_t WiFiEvent_t;
+typedef void (*WiFiEventCb)(WiFiEvent_t event);
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+#define 		WIFI_MAX_EVENT_CB	  4
+
+class WiFiClass
+{
+private:
+  wifi_mode_t _mode = WIFI_OFF;
+  wl_status_t _status = WL_IDLE_STATUS;
+  bool _apActive = false;
+  WiFiEventCb _callbacks[WIFI_MAX_EVENT_CB] = {};
+  esp_timer_handle_t _connectTimer = NULL;
+  static void connectDone(void *arg);
+
+public:
+  void onEvent(WiFiEventCb callback);
+  void emit(WiFiEvent_t event);			//host side, e.g. tests dropping the connection
+  bool mode(wifi_mode_t mode);
+  wifi_mode_t getMode() { return _mode; }
+  bool setAutoReconnect(bool autoReconnect) { return true; }
+  wl_status_t begin(const char *ssid,const char *passphrase = NULL);
+  bool disconnect(bool wifiOff = false);
+  wl_status_t status() { return _status; }
+  bool isConnected() { return _status == WL_CONNECTED; }
+  bool softAP(const char *ssid,const char *passphrase = NULL);
+  bool softAPdisconnect(bool wifiOff = false);
+  IPAddress localIP();
+  IPAddress softAPIP();
+};
+
+extern WiFiClass WiFi;
+
+#endif
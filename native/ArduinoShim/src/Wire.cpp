@@ -0,0 +1,264 @@
+/*
+bus time of a transaction =
+	START + 9 bits for every byte (8 data + ACK) including address bytes + repeated START + STOP
+at the clock set by setClock(). the calling task sleeps that long (shimSleepUs), like the ESP32 driver waits for
+the transfer to finish while other tasks run. driver overhead (command link setup, interrupts) is not modelled.
+
+a write followed by requestFrom() after endTransmission(false) is one transaction with a repeated START,
+exactly what arduino-esp32 does.
+
+holdSDA() makes a slave stuck in the middle of a byte: SDA reads LOW, every transaction waits for the Wire timeout
+and fails with 5 (timeout) until SCL pin is clocked with digitalWrite() enough times, like I2CBus::recover() does.
+*/
+
+#include <Wire.h>
+#include <shim.h>
+
+TwoWire Wire(0);
+TwoWire Wire1(1);
+
+TwoWire::TwoWire(uint8_t bus) : _bus(bus)
+{
+}
+
+bool TwoWire::begin(int sda,int scl,uint32_t frequency)
+{
+	if(frequency) _clockHz = frequency;
+	_sda = sda;
+	_scl = scl;
+	if(sda >= 0) pinMode(sda,INPUT_PULLUP);		//open drain with pull up, idle bus reads HIGH
+	if(scl >= 0) pinMode(scl,INPUT_PULLUP);
+	_sclLevel = HIGH;
+	return true;
+}
+
+bool TwoWire::end()
+{
+	return true;
+}
+
+bool TwoWire::setClock(uint32_t hz)
+{
+	if(hz == 0) return false;
+	_clockHz = hz;
+	return true;
+}
+
+uint32_t TwoWire::getClock()
+{
+	return _clockHz;
+}
+
+void TwoWire::setTimeOut(uint16_t timeOutMs)
+{
+	_timeOutMs = timeOutMs;
+}
+
+uint16_t TwoWire::getTimeOut()
+{
+	return _timeOutMs;
+}
+
+I2CDevice *TwoWire::find(uint8_t address)
+{
+	for(uint8_t i = 0; i < _deviceCount; i++){
+		if(_devices[i].address == address) return _devices[i].device;
+	}
+	return NULL;
+}
+
+/* counts one transaction and keeps the bus for it. a watched task gets its own copy of the counts,
+	so traffic of other tasks running while it sleeps here does not show up in watchedStats().
+*/
+void TwoWire::busTime(size_t bytesOnWire,uint8_t starts,size_t written,size_t read,bool nack)
+{
+	uint32_t bits = starts + 9 * bytesOnWire + 1;
+	uint32_t us = (uint32_t)(((uint64_t)bits * 1000000ULL + _clockHz - 1) / _clockHz);
+	WireStats *counted[2] = {&_stats,NULL};
+	if(_watchedTask != NULL && xTaskGetCurrentTaskHandle() == _watchedTask) counted[1] = &_watchedStats;
+	for(WireStats *s : counted){
+		if(s == NULL) continue;
+		s->transactions++;
+		s->bytesWritten += written;
+		s->bytesRead += read;
+		if(nack) s->nacks++;
+		s->busUs += us;
+		s->bits += bits;
+	}
+	shimSleepUs(us);
+}
+
+void TwoWire::beginTransmission(uint16_t address)
+{
+	_txAddress = address;
+	_txLength = 0;
+	_txPending = false;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+	if(_txLength >= I2C_BUFFER_LENGTH) return 0;
+	_txBuffer[_txLength++] = data;
+	return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data,size_t quantity)
+{
+	for(size_t i = 0; i < quantity; i++){
+		if(!write(data[i])) return i;
+	}
+	return quantity;
+}
+
+/* driver waits for the bus until its timeout */
+void TwoWire::stuck()
+{
+	_stats.transactions++;
+	shimSleepUs((uint32_t)_timeOutMs * 1000);
+}
+
+/* 0 == ok, 2 == address NACK, 3 == data NACK, 5 == timeout */
+uint8_t TwoWire::endTransmission(bool sendStop)
+{
+	if(!sendStop){
+		_txPending = true;
+		return 0;
+	}
+	if(sdaHeld()){
+		stuck();
+		return 5;
+	}
+	I2CDevice *device = find(_txAddress);
+	if(device == NULL){
+		busTime(1,1,0,0,true);
+		return 2;
+	}
+	bool acked = device->i2cWrite(_txBuffer,_txLength);
+	busTime(1 + _txLength,1,_txLength,0,!acked);
+	return acked ? 0 : 3;
+}
+
+size_t TwoWire::requestFrom(uint16_t address,size_t size,bool sendStop)
+{
+	if(size > I2C_BUFFER_LENGTH) size = I2C_BUFFER_LENGTH;
+	_rxLength = 0;
+	_rxIndex = 0;
+	bool combined = _txPending && _txAddress == address;
+	size_t written = combined ? _txLength : 0;
+	_txPending = false;
+	if(sdaHeld()){
+		stuck();
+		return 0;
+	}
+
+	I2CDevice *device = find(address);
+	if(device == NULL){
+		busTime(1,1,0,0,true);
+		return 0;
+	}
+	if(combined && !device->i2cWrite(_txBuffer,written)){
+		busTime(1 + written,1,0,0,true);
+		return 0;
+	}
+	_rxLength = device->i2cRead(_rxBuffer,size);
+	busTime((combined ? 1 + written : 0) + 1 + size,combined ? 2 : 1,written,_rxLength,false);
+	return _rxLength;
+}
+
+int TwoWire::available()
+{
+	return _rxLength - _rxIndex;
+}
+
+int TwoWire::read()
+{
+	return _rxIndex < _rxLength ? _rxBuffer[_rxIndex++] : -1;
+}
+
+int TwoWire::peek()
+{
+	return _rxIndex < _rxLength ? _rxBuffer[_rxIndex] : -1;
+}
+
+void TwoWire::flush()
+{
+	_rxLength = _rxIndex = 0;
+	_txLength = 0;
+}
+
+void TwoWire::attach(uint8_t address,I2CDevice *device)
+{
+	for(uint8_t i = 0; i < _deviceCount; i++){
+		if(_devices[i].address == address){
+			_devices[i].device = device;
+			return;
+		}
+	}
+	if(_deviceCount == WIRE_MAX_DEVICES) return;
+	_devices[_deviceCount].address = address;
+	_devices[_deviceCount].device = device;
+	_deviceCount++;
+}
+
+void TwoWire::detach(uint8_t address)
+{
+	for(uint8_t i = 0; i < _deviceCount; i++){
+		if(_devices[i].address == address){
+			_devices[i] = _devices[--_deviceCount];
+			return;
+		}
+	}
+}
+
+const WireStats &TwoWire::stats()
+{
+	return _stats;
+}
+
+void TwoWire::resetStats()
+{
+	memset(&_stats,0,sizeof(_stats));
+	memset(&_watchedStats,0,sizeof(_watchedStats));
+}
+
+/* starts counting from zero */
+void TwoWire::watchTask(TaskHandle_t task)
+{
+	_watchedTask = task;
+	memset(&_watchedStats,0,sizeof(_watchedStats));
+}
+
+const WireStats &TwoWire::watchedStats()
+{
+	return _watchedStats;
+}
+
+static void wirePinWritten(uint8_t pin,uint8_t level)
+{
+	Wire.pinWritten(pin,level);
+	Wire1.pinWritten(pin,level);
+}
+
+/* needs pins from begin() */
+void TwoWire::holdSDA(uint16_t clocks)
+{
+	if(_sda < 0 || clocks == 0) return;
+	_sdaHeldClocks = clocks;
+	shimPullLow(_sda,true);
+	shimOnPinWrite(wirePinWritten);
+}
+
+bool TwoWire::sdaHeld()
+{
+	return _sdaHeldClocks != 0;
+}
+
+/* slave shifts one bit out on every rising SCL edge, lets SDA go after its last one */
+void TwoWire::pinWritten(uint8_t pin,uint8_t level)
+{
+	if((int)pin != _scl) return;
+	bool rising = level == HIGH && _sclLevel == LOW;
+	_sclLevel = level;
+	if(!rising || _sdaHeldClocks == 0) return;
+	if(--_sdaHeldClocks == 0) shimPullLow(_sda,false);
+}
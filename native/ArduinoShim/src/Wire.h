@@ -0,0 +1,106 @@
+/* TwoWire of host builds. devices are C++ objects attached at an address (see I2CDevice),
+	every transaction takes bus time on the virtual clock and is counted in WireStats.
+*/
+
+#ifndef TwoWire_h
+#define TwoWire_h
+
+#include <Arduino.h>
+
+#define 		I2C_BUFFER_LENGTH	  128
+#define 		WIRE_MAX_DEVICES	  8
+
+/* a slave on the simulated bus */
+class I2CDevice
+{
+public:
+  virtual ~I2CDevice() {}
+  /* master wrote len bytes after the address byte. return false to NACK them */
+  virtual bool i2cWrite(const uint8_t *data,size_t len) = 0;
+  /* master reads len bytes, returns how many were filled in */
+  virtual size_t i2cRead(uint8_t *data,size_t len) = 0;
+};
+
+struct WireStats
+{
+  uint32_t transactions;		//START to STOP, a write with repeated START read counts once
+  uint32_t bytesWritten;		//data bytes, without address bytes
+  uint32_t bytesRead;
+  uint32_t nacks;
+  uint64_t busUs;				//time SCL was running
+  uint64_t bits;				//SCL clocks with START, repeated START and STOP, independent of clock rate
+
+  uint64_t busUsAt(uint32_t hz) const { return (bits * 1000000ULL + hz - 1) / hz; }
+};
+
+class TwoWire : public Stream
+{
+private:
+  uint8_t _bus;
+  uint32_t _clockHz = 100000;
+  uint16_t _timeOutMs = 50;
+  uint8_t _txAddress = 0;
+  uint8_t _txBuffer[I2C_BUFFER_LENGTH];
+  size_t _txLength = 0;
+  bool _txPending = false;		//endTransmission(false) waiting for requestFrom()
+  uint8_t _rxBuffer[I2C_BUFFER_LENGTH];
+  size_t _rxLength = 0;
+  size_t _rxIndex = 0;
+  struct { uint8_t address; I2CDevice *device; } _devices[WIRE_MAX_DEVICES];
+  uint8_t _deviceCount = 0;
+  WireStats _stats = {0, 0, 0, 0, 0, 0};
+  TaskHandle_t _watchedTask = NULL;
+  WireStats _watchedStats = {0, 0, 0, 0, 0, 0};
+  int _sda = -1;
+  int _scl = -1;
+  uint8_t _sclLevel = HIGH;
+  uint16_t _sdaHeldClocks = 0;
+
+  I2CDevice *find(uint8_t address);
+  void busTime(size_t bytesOnWire,uint8_t starts,size_t written,size_t read,bool nack);
+  void stuck();
+
+public:
+  TwoWire(uint8_t bus);
+  bool begin(int sda = -1,int scl = -1,uint32_t frequency = 0);
+  bool end();
+  bool setClock(uint32_t hz);
+  uint32_t getClock();
+  void setTimeOut(uint16_t timeOutMs);
+  uint16_t getTimeOut();
+
+  void beginTransmission(uint16_t address);
+  void beginTransmission(int address) { beginTransmission((uint16_t)address); }
+  void beginTransmission(uint8_t address) { beginTransmission((uint16_t)address); }
+  uint8_t endTransmission(bool sendStop);
+  uint8_t endTransmission() { return endTransmission(true); }
+  size_t requestFrom(uint16_t address,size_t size,bool sendStop);
+  uint8_t requestFrom(uint8_t address,uint8_t size) { return requestFrom((uint16_t)address,(size_t)size,true); }
+  uint8_t requestFrom(uint8_t address,uint8_t size,uint8_t sendStop) { return requestFrom((uint16_t)address,(size_t)size,sendStop != 0); }
+  uint8_t requestFrom(int address,int size) { return requestFrom((uint16_t)address,(size_t)size,true); }
+  uint8_t requestFrom(int address,int size,int sendStop) { return requestFrom((uint16_t)address,(size_t)size,sendStop != 0); }
+
+  size_t write(uint8_t data) override;
+  size_t write(const uint8_t *data,size_t quantity) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int peek() override;
+  void flush() override;
+
+  //host side
+  void attach(uint8_t address,I2CDevice *device);
+  void detach(uint8_t address);
+  const WireStats &stats();
+  void resetStats();
+  void watchTask(TaskHandle_t task);		//count transactions of this task alone too, NULL stops
+  const WireStats &watchedStats();
+  void holdSDA(uint16_t clocks);			//a slave keeps SDA low until SCL is clocked this many times
+  bool sdaHeld();
+  void pinWritten(uint8_t pin,uint8_t level);
+};
+
+extern TwoWire Wire;
+extern TwoWire Wire1;
+
+#endif
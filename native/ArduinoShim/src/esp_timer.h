@@ -0,0 +1,41 @@
+/* esp_timer on the virtual clock. callbacks run from the scheduler, like ESP_TIMER_TASK dispatch on the chip they
+	must not block.
+*/
+
+#ifndef esp_timer_h
+#define esp_timer_h
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef int esp_err_t;
+#define 		ESP_OK				  0
+#define 		ESP_FAIL			  -1
+#define 		ESP_ERR_INVALID_ARG	  0x102
+#define 		ESP_ERR_INVALID_STATE 0x103
+
+struct ShimTimer;
+typedef ShimTimer *esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void *arg);
+
+typedef enum {
+	ESP_TIMER_TASK,
+	ESP_TIMER_ISR
+} esp_timer_dispatch_t;
+
+typedef struct {
+	esp_timer_cb_t callback;
+	void *arg;
+	esp_timer_dispatch_t dispatch_method;
+	const char *name;
+	bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args,esp_timer_handle_t *handle);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer,uint64_t timeoutUs);
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer,uint64_t periodUs);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+esp_err_t esp_timer_delete(esp_timer_handle_t timer);
+int64_t esp_timer_get_time();
+
+#endif
@@ -0,0 +1,26 @@
+/* FreeRTOS subset for host builds. tasks are real threads but only one runs at a time,
+	picked by priority like on the chip, and all waiting happens on the virtual clock (see Scheduler.cpp).
+*/
+
+#ifndef FreeRTOS_h
+#define FreeRTOS_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int32_t BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define 		configTICK_RATE_HZ	  1000
+#define 		portTICK_PERIOD_MS	  (1000 / configTICK_RATE_HZ)
+#define 		portMAX_DELAY		  ((TickType_t)0xFFFFFFFFUL)
+#define 		pdMS_TO_TICKS(ms)	  ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+#define 		pdTRUE				  ((BaseType_t)1)
+#define 		pdFALSE				  ((BaseType_t)0)
+#define 		pdPASS				  pdTRUE
+#define 		pdFAIL				  pdFALSE
+#define 		errQUEUE_FULL		  pdFALSE
+#define 		portYIELD_FROM_ISR()
+
+#endif
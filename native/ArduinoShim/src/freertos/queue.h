@@ -0,0 +1,20 @@
+#ifndef FreeRTOS_queue_h
+#define FreeRTOS_queue_h
+
+#include <freertos/FreeRTOS.h>
+
+struct ShimQueue;
+typedef ShimQueue *QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length,UBaseType_t itemSize);
+void vQueueDelete(QueueHandle_t queue);
+BaseType_t xQueueSend(QueueHandle_t queue,const void *item,TickType_t ticksToWait);
+BaseType_t xQueueSendToBack(QueueHandle_t queue,const void *item,TickType_t ticksToWait);
+BaseType_t xQueueSendToFront(QueueHandle_t queue,const void *item,TickType_t ticksToWait);
+BaseType_t xQueueOverwrite(QueueHandle_t queue,const void *item);
+BaseType_t xQueueReceive(QueueHandle_t queue,void *item,TickType_t ticksToWait);
+BaseType_t xQueuePeek(QueueHandle_t queue,void *item,TickType_t ticksToWait);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+BaseType_t xQueueReset(QueueHandle_t queue);
+
+#endif
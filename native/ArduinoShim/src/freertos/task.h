@@ -0,0 +1,25 @@
+#ifndef FreeRTOS_task_h
+#define FreeRTOS_task_h
+
+#include <freertos/FreeRTOS.h>
+
+struct ShimTask;
+typedef ShimTask *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+BaseType_t xTaskCreate(TaskFunction_t fn,const char *name,uint32_t stackDepth,void *param,UBaseType_t priority,TaskHandle_t *handle);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn,const char *name,uint32_t stackDepth,void *param,UBaseType_t priority,TaskHandle_t *handle,BaseType_t core);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t *previousWake,TickType_t increment);
+TickType_t xTaskGetTickCount();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task);
+const char *pcTaskGetName(TaskHandle_t task);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+void taskYIELD();
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit,TickType_t ticksToWait);
+
+#endif
@@ -0,0 +1,20 @@
+/* controls of the host build that firmware never calls: virtual clock, run length, CPU time */
+
+#ifndef shim_h
+#define shim_h
+
+#include <stdint.h>
+
+typedef void (*ShimExitHook)(void);
+typedef void (*ShimPinListener)(uint8_t pin,uint8_t level);
+
+uint64_t shimNowUs();
+void shimSetRunLimitMs(uint64_t ms);		//0 == run until every task blocks for ever
+void shimOnExit(ShimExitHook hook);			//called once when run limit is reached
+void shimSleepUs(uint32_t us);				//calling task waits, other tasks run (I2C transfer, DMA ...)
+void shimBusyUs(uint32_t us);				//calling task uses CPU, only higher priority tasks can run
+[[noreturn]] void shimExit(int status);
+void shimPullLow(uint8_t pin,bool low);		//another device drives pin low (open drain), digitalRead() sees LOW
+void shimOnPinWrite(ShimPinListener listener);	//called after every digitalWrite(), NULL stops
+
+#endif
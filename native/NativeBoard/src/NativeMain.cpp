@@ -0,0 +1,142 @@
+/*
+entry point of host builds, does what the arduino-esp32 core does: setup() once, then loop() for ever
+in the "loopTask" (the main thread, see Scheduler.cpp).
+
+the bus has the parts of the board: QN8027 model (QN8027Sim) at 0x2C and a sink at 0x3C for the OLED.
+
+environment:
+	NATIVE_RUN_MS		virtual run time, default 10000, 0 runs until every task blocks for ever
+	NATIVE_AUDIO		input level script "ms:mV,ms:mV,...", default "0:450" (peak 10 at chip defaults)
+	NATIVE_QN8027_LOG	file to write QN8027 transactions and RDS groups to at exit
+	NATIVE_REPLAY		trace from the chip (/api/trace binary or 'trace dump' text) to replay into the model
+					instead of running the firmware, exit status 1 when model and chip went different ways
+	NATIVE_WIFI_CONNECT_MS	see WiFi.h
+	NATIVE_FS_ROOT		directory served as SPIFFS, default "data"
+serial input is read from stdin when it is not a terminal, see HardwareSerial.h.
+
+main() is weak so unit tests (pio test -e native) can bring their own.
+*/
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <I2CDevices.h>
+#include <QN8027Sim.h>
+#include <QN8027Replay.h>
+#include <shim.h>
+#include <vector>
+
+#define 		AUDIO_SCRIPT_MAX	  32
+
+static QN8027Sim radioChip;
+static I2CSink oledPanel;
+
+static void loadAudioScript()
+{
+	const char *text = getenv("NATIVE_AUDIO");
+	if(text == NULL) text = "0:450";
+	QN8027SimLevel levels[AUDIO_SCRIPT_MAX];
+	size_t count = 0;
+	while(*text && count < AUDIO_SCRIPT_MAX){
+		char *end;
+		levels[count].atMs = strtoul(text,&end,10);
+		if(*end != ':') break;
+		levels[count].mV = strtoul(end + 1,&end,10);
+		count++;
+		text = *end == ',' ? end + 1 : end;
+	}
+	radioChip.setInputScript(levels,count);
+}
+
+/* binary image as /api/trace gives it, or 'trace dump' output where image is in lines starting with ':' */
+static bool loadTrace(const char *path,std::vector<uint8_t> &image)
+{
+	FILE *in = fopen(path,"rb");
+	if(in == NULL) return false;
+	int c;
+	while((c = fgetc(in)) != EOF) image.push_back(c);
+	fclose(in);
+	if(image.size() >= 4 && memcmp(image.data(),"QNTR",4) == 0) return true;
+
+	std::vector<uint8_t> text;
+	text.swap(image);
+	bool lineStart = true;
+	bool inLine = false;
+	int high = -1;
+	for(uint8_t ch : text){
+		if(ch == '\n' || ch == '\r'){
+			lineStart = true;
+			inLine = false;
+			high = -1;
+			continue;
+		}
+		if(lineStart && ch == ':'){
+			inLine = true;
+		}else if(inLine && isxdigit(ch)){
+			int nibble = isdigit(ch) ? ch - '0' : (toupper(ch) - 'A' + 10);
+			if(high < 0){
+				high = nibble;
+			}else{
+				image.push_back((high << 4) | nibble);
+				high = -1;
+			}
+		}
+		lineStart = false;
+	}
+	return !image.empty();
+}
+
+static int replayTrace(const char *path)
+{
+	std::vector<uint8_t> image;
+	if(!loadTrace(path,image)){
+		fprintf(stderr,"[replay] cannot read %s\n",path);
+		return 2;
+	}
+	QN8027Replay replay(radioChip,stdout);
+	if(!replay.run(image.data(),image.size())){
+		fprintf(stderr,"[replay] %s is not a QN8027 trace\n",path);
+		return 2;
+	}
+	const QN8027ReplayResult &r = replay.result;
+	return r.readDiffs || r.resultDiffs || r.stateDiffs ? 1 : 0;
+}
+
+static void report()
+{
+	fflush(stdout);
+	const WireStats &s = Wire.stats();
+	fprintf(stderr,"[shim] %.3f s virtual time, I2C %u transactions, %u bytes written, %u read, %u NACK, bus busy %.1f ms\n",
+		shimNowUs() / 1e6,s.transactions,s.bytesWritten,s.bytesRead,s.nacks,s.busUs / 1000.0);
+	fprintf(stderr,"[shim] QN8027: %u RDS groups taken, %u retunes, %u PA off, %u resets\n",
+		(unsigned)radioChip.groups().size(),radioChip.retunes,radioChip.paOffs,radioChip.resets);
+
+	const char *logPath = getenv("NATIVE_QN8027_LOG");
+	if(logPath == NULL) return;
+	FILE *out = fopen(logPath,"w");
+	if(out == NULL){
+		fprintf(stderr,"[shim] cannot write %s\n",logPath);
+		return;
+	}
+	radioChip.printLog(out);
+	fclose(out);
+}
+
+__attribute__((weak)) int main(int argc,char **argv)
+{
+	setvbuf(stdout,NULL,_IOLBF,0);
+	Wire.attach(QN8027_SIM_ADDR,&radioChip);
+	Wire.attach(0x3C,&oledPanel);
+	loadAudioScript();
+
+	const char *replayPath = getenv("NATIVE_REPLAY");
+	if(replayPath != NULL) return replayTrace(replayPath);		//as long as trace is, no run limit
+
+	const char *runMs = getenv("NATIVE_RUN_MS");
+	shimSetRunLimitMs(runMs != NULL ? strtoull(runMs,NULL,10) : 10000);
+	shimOnExit(report);
+
+	setup();
+	for(;;){
+		loop();
+	}
+}
@@ -0,0 +1,151 @@
+/*
+replay starts with a power cycle of the model, waits for its power on calibration and then sends every
+recorded transaction through Wire at the same distance from the first one as on the chip.
+
+- a write is sent as it was, a different ACK/NACK than recorded is a difference
+- a read is made again and compared byte by byte with what the chip returned. STATUS_REG carries FSM state,
+  RDS toggle and audio peak, so this is where timing of model and chip shows up (a toggle one group late,
+  PA calibration taking longer ...)
+- a transaction that cannot start at its time because the one before it is still on the bus counts as late,
+  chip bus was faster than the replay clock (Wire.setClock())
+- at the end registers are compared with what the trace says chip held: last value written or read
+
+a trace which lost its oldest records (ring overflow) or was started on a running transmitter does not
+start from power on, first differences then only tell that the model started from another state.
+'trace on' followed by 'reset' gives a trace both can start from.
+*/
+
+#include <QN8027Replay.h>
+#include <shim.h>
+#include <stdarg.h>
+
+#define 		REPLAY_STATUS_REG	  0x07
+#define 		REPLAY_SWRST		  0x80
+
+QN8027Replay::QN8027Replay(QN8027Sim &chip,FILE *out) : _chip(chip), _out(out)
+{
+	memset(&result,0,sizeof(result));
+	result.firstDiffUs = QN8027_SIM_NO_EVENT;
+}
+
+void QN8027Replay::difference(uint64_t atUs,const char *format,...)
+{
+	if(result.firstDiffUs == QN8027_SIM_NO_EVENT) result.firstDiffUs = atUs;
+	if(_out == NULL || _printed++ >= QN8027_REPLAY_PRINT_MAX) return;
+	fprintf(_out,"%11.6f ",atUs / 1e6);
+	va_list args;
+	va_start(args,format);
+	vfprintf(_out,format,args);
+	va_end(args);
+	fputc('\n',_out);
+}
+
+void QN8027Replay::expect(uint8_t reg,const uint8_t *data,uint8_t len)
+{
+	for(uint8_t i = 0; i < len && reg + i < QN8027_SIM_REGS; i++){
+		_expected[reg + i] = data[i];
+		_knownRegs |= 1UL << (reg + i);
+	}
+}
+
+void QN8027Replay::replayWrite(const QN8027TraceRecord &rec,uint64_t atUs)
+{
+	result.writes++;
+	Wire.beginTransmission(rec.address);
+	Wire.write(rec.reg);
+	Wire.write(rec.data,rec.len);
+	uint8_t code = Wire.endTransmission();
+	if(code != rec.result){
+		result.resultDiffs++;
+		difference(atUs,"W %02X: result %u on chip, %u on model",rec.reg,rec.result,code);
+	}
+	if(rec.result == 0) expect(rec.reg,rec.data,rec.len);
+}
+
+void QN8027Replay::replayRead(const QN8027TraceRecord &rec,uint64_t atUs)
+{
+	result.reads++;
+	uint8_t data[QN8027_TRACE_DATA_MAX];
+	memset(data,0,sizeof(data));
+	Wire.beginTransmission(rec.address);
+	Wire.write(rec.reg);
+	uint8_t code = Wire.endTransmission(false);
+	size_t received = Wire.requestFrom((uint16_t)rec.address,(size_t)rec.len,true);
+	for(size_t i = 0; i < received && i < sizeof(data); i++) data[i] = Wire.read();
+	uint8_t resultNow = code ? code : (received < rec.len ? QN8027_TRACE_SHORT_READ : 0);
+	if(resultNow != rec.result){
+		result.resultDiffs++;
+		difference(atUs,"R %02X: result %u on chip, %u on model",rec.reg,rec.result,resultNow);
+	}
+	if(rec.result == 0 && memcmp(data,rec.data,rec.len) != 0){
+		result.readDiffs++;
+		char chipText[3 * QN8027_TRACE_DATA_MAX + 1] = "";
+		char modelText[3 * QN8027_TRACE_DATA_MAX + 1] = "";
+		for(uint8_t i = 0; i < rec.len; i++){
+			snprintf(chipText + 3 * i,4," %02X",rec.data[i]);
+			snprintf(modelText + 3 * i,4," %02X",data[i]);
+		}
+		difference(atUs,"R %02X: chip%s, model%s",rec.reg,chipText,modelText);
+	}
+	if(rec.result == 0) expect(rec.reg,rec.data,rec.len);
+}
+
+/* STATUS_REG is left out, it moves by itself and every read of it was already compared */
+void QN8027Replay::compareEndState()
+{
+	for(uint8_t reg = 0; reg < QN8027_SIM_REGS; reg++){
+		if(reg == REPLAY_STATUS_REG || !(_knownRegs & (1UL << reg))) continue;
+		uint8_t now = _chip.reg(reg);
+		if(now == _expected[reg]) continue;
+		result.stateDiffs++;
+		if(_out) fprintf(_out,"end %02X: chip %02X, model %02X\n",reg,_expected[reg],now);
+	}
+}
+
+bool QN8027Replay::run(const uint8_t *image,size_t len)
+{
+	QN8027TraceReader reader(image,len);
+	if(!reader.valid()) return false;
+	if(_out && reader.dropped) fprintf(_out,"trace lost %u oldest records, it does not start at power on\n",reader.dropped);
+
+	_chip.powerOn();
+	shimSleepUs(_chip.timing.recalUs);
+	uint64_t startUs = shimNowUs();
+	uint64_t traceUs = 0;
+	uint32_t lastTimeUs = 0;
+	QN8027TraceRecord rec;
+	while(reader.next(&rec)){
+		if(result.records == 0 && _out && !(!rec.read && rec.reg == 0 && rec.len && (rec.data[0] & REPLAY_SWRST))){
+			fprintf(_out,"trace does not start with a soft reset, model state may differ from the start\n");
+		}
+		if(result.records) traceUs += (uint32_t)(rec.timeUs - lastTimeUs);	//micros() wraps every 71 minutes
+		lastTimeUs = rec.timeUs;
+		result.records++;
+
+		uint64_t dueUs = startUs + traceUs;
+		uint64_t nowUs = shimNowUs();
+		if(nowUs < dueUs){
+			shimSleepUs(dueUs - nowUs);
+		}else if(nowUs > dueUs){
+			result.late++;
+			if(nowUs - dueUs > result.maxLateUs) result.maxLateUs = nowUs - dueUs;
+		}
+		if(rec.read){
+			replayRead(rec,traceUs);
+		}else{
+			replayWrite(rec,traceUs);
+		}
+	}
+	result.traceUs = traceUs;
+	result.replayUs = shimNowUs() - startUs;
+	compareEndState();
+
+	if(_out){
+		fprintf(_out,"%u records (%u writes, %u reads), %.3f s on chip, %.3f s on model\n",result.records,
+			result.writes,result.reads,result.traceUs / 1e6,result.replayUs / 1e6);
+		fprintf(_out,"%u read differences, %u ACK differences, %u registers differ at end, %u late (max %u us)\n",
+			result.readDiffs,result.resultDiffs,result.stateDiffs,result.late,result.maxLateUs);
+		if(result.firstDiffUs != QN8027_SIM_NO_EVENT) fprintf(_out,"first difference at %.6f s\n",result.firstDiffUs / 1e6);
+	}
+	return true;
+}
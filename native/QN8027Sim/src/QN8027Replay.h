@@ -0,0 +1,52 @@
+/* replays a trace recorded by QN8027Trace on the chip into QN8027Sim, transaction by transaction at
+	recorded times, and tells where model and real chip went different ways:
+	QN8027Replay replay(chip,stdout);
+	replay.run(image,len);
+*/
+
+#ifndef QN8027Replay_h
+#define QN8027Replay_h
+
+#include <QN8027Sim.h>
+#include <QN8027Trace.h>
+
+#define 		QN8027_REPLAY_PRINT_MAX	  20		//differences printed, all are counted
+
+struct QN8027ReplayResult
+{
+  uint32_t records;
+  uint32_t writes;
+  uint32_t reads;
+  uint32_t readDiffs;					//reads where model returned other data than chip did
+  uint32_t resultDiffs;				//ACK/NACK not same as recorded
+  uint32_t late;						//transactions replay could not start at recorded time
+  uint32_t maxLateUs;
+  uint64_t firstDiffUs;				//trace time of first difference, QN8027_SIM_NO_EVENT when none
+  uint32_t stateDiffs;				//registers ending with other value than trace says chip had
+  uint64_t traceUs;					//first to last record on chip
+  uint64_t replayUs;					//same on model, including bus time of last one
+};
+
+class QN8027Replay
+{
+private:
+  QN8027Sim &_chip;
+  FILE *_out;
+  uint8_t _expected[QN8027_SIM_REGS];
+  uint32_t _knownRegs = 0;
+  uint32_t _printed = 0;
+
+  void difference(uint64_t atUs,const char *format,...) __attribute__((format(printf,3,4)));
+  void expect(uint8_t reg,const uint8_t *data,uint8_t len);
+  void replayWrite(const QN8027TraceRecord &rec,uint64_t atUs);
+  void replayRead(const QN8027TraceRecord &rec,uint64_t atUs);
+  void compareEndState();
+
+public:
+  QN8027ReplayResult result;
+
+  QN8027Replay(QN8027Sim &chip,FILE *out);		//out NULL == only result
+  bool run(const uint8_t *image,size_t len);		//false when image is not a trace
+};
+
+#endif
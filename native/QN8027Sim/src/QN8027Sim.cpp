@@ -0,0 +1,360 @@
+/*
+what the model does, in the order STATUS_REG shows it-
+
+power on, SWRST (SYSTEM bit 7) :	RESETTING -> RECALIBRATING -> IDLE, SWRST also loads register defaults
+RECAL (SYSTEM bit 6)			:	held in RESETTING while bit is 1, RECALIBRATING -> IDLE after it goes back to 0
+TXREQ (SYSTEM bit 5)			:	IDLE -> TX_READY -> PA_CALIBRATION -> TRANSMITTING, clearing it goes back to IDLE
+channel (SYSTEM bits 1:0, CH1)	:	while on air, PA_CALIBRATION for timing.retuneUs, then TRANSMITTING again
+silence							:	GPLT bits 5:4 select 58/59/60 s or never, after that much silence on air -> PA_OFF,
+									audio coming back calibrates PA and transmits again
+
+RDS: chip sends one group every timing.groupUs, group clock starts when TRANSMITTING is entered.
+toggling RDSRDY (SYSTEM bit 2) latches RDSD0..RDSD7, chip takes them at next group boundary and flips RDS_UPD
+(STATUS bit 3). a second RDSRDY toggle before that takes latch back. without RDS enable (RDS_REG bit 7) or carrier
+nothing is taken and RDS_UPD stays, so host timeouts can be tested.
+
+audio: input level in mV comes from setInputMv() or a script. peak detector (STATUS bits 7:4, 45 mV per step)
+holds highest level since PAC bit 7 last changed. level is scaled by input buffer gain, input impedance and
+digital gain from VGA_REG, 0 dB at chip defaults.
+
+model time only moves when firmware touches the chip or a getter is called, events in between
+(state timers, group boundaries, script points) are replayed in order at their own time.
+*/
+
+#include <QN8027Sim.h>
+#include <shim.h>
+#include <math.h>
+
+#define 		SIM_SYSTEM			  0x00
+#define 		SIM_CH1				  0x01
+#define 		SIM_GPLT			  0x02
+#define 		SIM_VGA				  0x04
+#define 		SIM_CID1			  0x05
+#define 		SIM_CID2			  0x06
+#define 		SIM_STATUS			  0x07
+#define 		SIM_RDSD0			  0x08
+#define 		SIM_PAC				  0x10
+#define 		SIM_RDS				  0x12
+
+#define 		SIM_SWRST			  0x80
+#define 		SIM_RECAL			  0x40
+#define 		SIM_TXREQ			  0x20
+#define 		SIM_RDSRDY			  0x04
+#define 		SIM_RDS_UPD			  0x08
+
+static const uint8_t defaultRegs[QN8027_SIM_REGS] = {
+	0x00, 0x00, 0xB9, 0x10, 0xB2, 0x00, 0x40, 0x00,	//SYSTEM..STATUS
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,	//RDSD0..RDSD7
+	0x7F, 0x81, 0x06								//PAC, FDEV, RDS
+};
+
+/* model starts at virtual time 0 in RECALIBRATING like a chip powered together with the MCU.
+	nothing from the shim is called here, so it can be a global.
+*/
+QN8027Sim::QN8027Sim()
+{
+	setDefaults();
+	_fsmDueUs = timing.recalUs;
+}
+
+/* power cycle at current virtual time, counters start from 0 again */
+void QN8027Sim::powerOn()
+{
+	_nowUs = shimNowUs();
+	resets = recalibrations = retunes = paOffs = rdsLatches = rdsOverruns = 0;
+	setDefaults();
+	_pointer = 0;
+	_rdsToggle = 0;
+	_takenRdy = 0;
+	_groupPending = false;
+	_peakMv = _levelMv;
+	passState(SIM_FSM_RECALIBRATING,timing.recalUs);
+}
+
+void QN8027Sim::setDefaults()
+{
+	memcpy(_regs,defaultRegs,sizeof(_regs));
+}
+
+//------------------------------state machine------------------------------------------------
+
+/* state that lasts until a register write changes it */
+void QN8027Sim::enterState(uint8_t state)
+{
+	_fsm = state;
+	_fsmDueUs = QN8027_SIM_NO_EVENT;
+	if(state == SIM_FSM_TRANSMITTING) _txStartUs = _nowUs;
+}
+
+/* state that ends by itself after forUs, see stateDone() */
+void QN8027Sim::passState(uint8_t state,uint32_t forUs)
+{
+	_fsm = state;
+	_fsmDueUs = _nowUs + forUs;
+}
+
+void QN8027Sim::stateDone()
+{
+	switch(_fsm){
+		case SIM_FSM_RESETTING:
+			passState(SIM_FSM_RECALIBRATING,timing.recalUs);
+			break;
+		case SIM_FSM_RECALIBRATING:
+			if(_regs[SIM_SYSTEM] & SIM_TXREQ) passState(SIM_FSM_TX_READY,timing.txReadyUs);
+			else enterState(SIM_FSM_IDLE);
+			break;
+		case SIM_FSM_TX_READY:
+			passState(SIM_FSM_PA_CALIBRATION,timing.paCalUs);
+			break;
+		default:
+			enterState(SIM_FSM_TRANSMITTING);
+			break;
+	}
+}
+
+void QN8027Sim::channelChanged()
+{
+	if(_fsm == SIM_FSM_PA_CALIBRATION || _fsm == SIM_FSM_TRANSMITTING){
+		retunes++;
+		passState(SIM_FSM_PA_CALIBRATION,timing.retuneUs);
+	}
+}
+
+/* next group boundary chip takes latched group at, QN8027_SIM_NO_EVENT when it will not take one */
+uint64_t QN8027Sim::nextBoundary()
+{
+	if(!_groupPending || _fsm != SIM_FSM_TRANSMITTING || !(_regs[SIM_RDS] & 0x80)) return QN8027_SIM_NO_EVENT;
+	uint64_t from = _latchUs > _txStartUs ? _latchUs : _txStartUs;
+	return _txStartUs + ((from - _txStartUs) / timing.groupUs + 1) * timing.groupUs;
+}
+
+uint64_t QN8027Sim::autoOffDue()
+{
+	uint8_t select = (_regs[SIM_GPLT] >> 4) & 3;
+	if(select == 3 || _fsm != SIM_FSM_TRANSMITTING || peakNibble(_levelMv) != 0) return QN8027_SIM_NO_EVENT;
+	uint64_t from = _silentSinceUs > _txStartUs ? _silentSinceUs : _txStartUs;
+	return from + (58 + select) * 1000000ULL;
+}
+
+/* replays everything due up to nowUs in time order */
+void QN8027Sim::advance(uint64_t nowUs)
+{
+	for(;;){
+		uint64_t scriptUs = _scriptPos < _script.size() ? _script[_scriptPos].atMs * 1000ULL : QN8027_SIM_NO_EVENT;
+		uint64_t groupUs = nextBoundary();
+		uint64_t offUs = autoOffDue();
+		uint64_t next = _fsmDueUs;
+		if(scriptUs < next) next = scriptUs;
+		if(groupUs < next) next = groupUs;
+		if(offUs < next) next = offUs;
+		if(next > nowUs) break;
+		if(next > _nowUs) _nowUs = next;
+
+		if(scriptUs == next){
+			applyLevel(_script[_scriptPos++].mV);
+		}else if(_fsmDueUs == next){
+			stateDone();
+		}else if(groupUs == next){
+			QN8027SimGroup group;
+			group.timeUs = _nowUs;
+			memcpy(group.data,&_regs[SIM_RDSD0],8);
+			_groups.push_back(group);
+			_rdsToggle ^= SIM_RDS_UPD;
+			_takenRdy = _regs[SIM_SYSTEM] & SIM_RDSRDY;
+			_groupPending = false;
+		}else{
+			paOffs++;
+			enterState(SIM_FSM_PA_OFF);
+		}
+	}
+	if(nowUs > _nowUs) _nowUs = nowUs;
+}
+
+//------------------------------registers----------------------------------------------------
+
+uint8_t QN8027Sim::regValue(uint8_t addr)
+{
+	if(addr == SIM_STATUS) return (peakNibble(_peakMv) << 4) | _rdsToggle | _fsm;
+	return addr < QN8027_SIM_REGS ? _regs[addr] : 0;
+}
+
+void QN8027Sim::writeReg(uint8_t addr,uint8_t value)
+{
+	if(addr >= QN8027_SIM_REGS || addr == SIM_CID1 || addr == SIM_CID2 || addr == SIM_STATUS) return;	//read only
+	uint8_t old = _regs[addr];
+	if(addr == SIM_SYSTEM && (value & SIM_SWRST)){
+		resets++;
+		setDefaults();
+		_rdsToggle = 0;
+		_takenRdy = 0;
+		_groupPending = false;
+		_peakMv = _levelMv;
+		passState(SIM_FSM_RESETTING,timing.resetUs);
+		return;
+	}
+	_regs[addr] = value;
+	uint8_t changed = old ^ value;
+
+	if(addr == SIM_SYSTEM){
+		if(changed & SIM_RECAL){
+			if(value & SIM_RECAL){
+				recalibrations++;
+				enterState(SIM_FSM_RESETTING);
+			}else{
+				passState(SIM_FSM_RECALIBRATING,timing.recalUs);
+			}
+		}else if(!(value & SIM_RECAL)){
+			if((value & SIM_TXREQ) && _fsm == SIM_FSM_IDLE) passState(SIM_FSM_TX_READY,timing.txReadyUs);
+			if(!(value & SIM_TXREQ) && _fsm >= SIM_FSM_TX_READY) enterState(SIM_FSM_IDLE);
+		}
+		if(changed & SIM_RDSRDY){
+			rdsLatches++;
+			if(_groupPending) rdsOverruns++;
+			_groupPending = (value & SIM_RDSRDY) != _takenRdy;
+			_latchUs = _nowUs;
+		}
+	}else if(addr == SIM_PAC && (changed & 0x80)){
+		_peakMv = _levelMv;		//peak detection starts again
+	}
+}
+
+/* first byte sets register pointer, rest are written to consecutive registers. writes to read only
+	registers and past RDS_REG are ACKed and ignored.
+*/
+bool QN8027Sim::i2cWrite(const uint8_t *data,size_t len)
+{
+	advance(shimNowUs());
+	if(nackNext){
+		nackNext--;
+		return false;
+	}
+	if(len == 0){
+		logTransaction(false,_pointer,NULL,0);
+		return true;
+	}
+	uint8_t start = data[0];
+	uint16_t channelBefore = channel();
+	_pointer = start;
+	for(size_t i = 1; i < len; i++) writeReg(_pointer++,data[i]);
+	if(channel() != channelBefore) channelChanged();	//SYSTEM and CH1 in one burst is one retune
+	logTransaction(false,start,data + 1,len - 1);
+	return true;
+}
+
+/* reads continue from register pointer, which a write without data (or repeated START after it) sets */
+size_t QN8027Sim::i2cRead(uint8_t *data,size_t len)
+{
+	advance(shimNowUs());
+	uint8_t start = _pointer;
+	for(size_t i = 0; i < len; i++) data[i] = regValue(_pointer++);
+	logTransaction(true,start,data,len);
+	return len;
+}
+
+uint8_t QN8027Sim::reg(uint8_t addr)
+{
+	advance(shimNowUs());
+	return regValue(addr);
+}
+
+uint8_t QN8027Sim::fsm()
+{
+	advance(shimNowUs());
+	return _fsm;
+}
+
+uint16_t QN8027Sim::channel()
+{
+	return (((_regs[SIM_SYSTEM] & 3) << 8) | _regs[SIM_CH1]) * 5 + 7600;
+}
+
+bool QN8027Sim::onAir()
+{
+	return fsm() == SIM_FSM_TRANSMITTING;
+}
+
+//------------------------------audio input--------------------------------------------------
+
+void QN8027Sim::applyLevel(uint16_t mV)
+{
+	bool wasSilent = peakNibble(_levelMv) == 0;
+	_levelMv = mV;
+	if(mV > _peakMv) _peakMv = mV;
+	bool silent = peakNibble(mV) == 0;
+	if(silent && !wasSilent) _silentSinceUs = _nowUs;
+	if(!silent && _fsm == SIM_FSM_PA_OFF) passState(SIM_FSM_PA_CALIBRATION,timing.paCalUs);
+}
+
+/* constant level from now on, replaces script */
+void QN8027Sim::setInputMv(uint16_t mV)
+{
+	advance(shimNowUs());
+	_script.clear();
+	_scriptPos = 0;
+	applyLevel(mV);
+}
+
+/* levels at absolute virtual times, sorted by atMs. points already in the past are applied right away */
+void QN8027Sim::setInputScript(const QN8027SimLevel *levels,size_t count)
+{
+	advance(shimNowUs());
+	_script.assign(levels,levels + count);
+	_scriptPos = 0;
+}
+
+/* STATUS_REG peak value a level of mV gives with current VGA_REG */
+uint8_t QN8027Sim::peakNibble(uint16_t mV)
+{
+	uint8_t vga = _regs[SIM_VGA];
+	int gainDb = 3 * (((vga >> 4) & 7) + 1) - 6 * (vga & 3) + ((vga >> 2) & 3);
+	double peak = mV * pow(10.0,gainDb / 20.0) / 45.0;
+	return peak >= 15 ? 15 : (uint8_t)peak;
+}
+
+//------------------------------log----------------------------------------------------------
+
+void QN8027Sim::logTransaction(bool read,uint8_t reg,const uint8_t *data,size_t len)
+{
+	if(_log.size() >= QN8027_SIM_LOG_MAX){
+		droppedLog++;
+		return;
+	}
+	QN8027SimTransaction t;
+	t.timeUs = _nowUs;
+	t.read = read;
+	t.reg = reg;
+	t.len = len < sizeof(t.data) ? len : sizeof(t.data);
+	if(t.len) memcpy(t.data,data,t.len);
+	_log.push_back(t);
+}
+
+void QN8027Sim::clearLog()
+{
+	_log.clear();
+	_groups.clear();
+	droppedLog = 0;
+}
+
+/* transactions and groups chip took, in time order-
+	   1.234567 W 08: 64 00 02 68 E0 CD 51 4E
+	   1.234890 R 07: 5D
+	   1.301200 G     64 00 02 68 E0 CD 51 4E
+*/
+void QN8027Sim::printLog(FILE *out)
+{
+	size_t g = 0;
+	for(size_t i = 0; i <= _log.size(); i++){
+		uint64_t until = i < _log.size() ? _log[i].timeUs : QN8027_SIM_NO_EVENT;
+		for(; g < _groups.size() && _groups[g].timeUs <= until; g++){
+			fprintf(out,"%11.6f G    ",_groups[g].timeUs / 1e6);
+			for(uint8_t b = 0; b < 8; b++) fprintf(out," %02X",_groups[g].data[b]);
+			fputc('\n',out);
+		}
+		if(i == _log.size()) break;
+		const QN8027SimTransaction &t = _log[i];
+		fprintf(out,"%11.6f %c %02X:",t.timeUs / 1e6,t.read ? 'R' : 'W',t.reg);
+		for(uint8_t b = 0; b < t.len; b++) fprintf(out," %02X",t.data[b]);
+		fputc('\n',out);
+	}
+	if(droppedLog) fprintf(out,"... %u more transactions not kept\n",droppedLog);
+}
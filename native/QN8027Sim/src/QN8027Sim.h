@@ -0,0 +1,137 @@
+/* behavioural model of QN8027 for host builds, attach it to the simulated bus:
+	QN8027Sim chip;
+	Wire.attach(QN8027_SIM_ADDR,&chip);
+it has registers 0x00 - 0x12, FSM states of STATUS_REG, RDS group clock and audio peak detector,
+all on the virtual clock. every transaction and every RDS group chip took is logged with its time.
+*/
+
+#ifndef QN8027Sim_h
+#define QN8027Sim_h
+
+#include <Wire.h>
+#include <stdio.h>
+#include <vector>
+
+#define 		QN8027_SIM_ADDR		  0x2C
+#define 		QN8027_SIM_REGS		  0x13
+#define 		QN8027_SIM_LOG_MAX	  65536	//transactions kept, later ones are only counted
+#define 		QN8027_SIM_NO_EVENT	  UINT64_MAX
+
+//STATUS_REG bits 2:0
+enum QN8027SimFSM
+{
+  SIM_FSM_RESETTING = 0,
+  SIM_FSM_RECALIBRATING,
+  SIM_FSM_IDLE,
+  SIM_FSM_TX_READY,
+  SIM_FSM_PA_CALIBRATION,
+  SIM_FSM_TRANSMITTING,
+  SIM_FSM_PA_OFF
+};
+
+/* how long chip stays in each passing state. datasheet gives no numbers, these are close to what
+	a logic analyser shows on real boards and can be changed per test.
+*/
+struct QN8027SimTiming
+{
+  uint32_t resetUs = 1000;			//SWRST
+  uint32_t recalUs = 10000;			//RECALIBRATING after power on, SWRST or RECAL
+  uint32_t txReadyUs = 1000;			//TXREQ set until PA calibration
+  uint32_t paCalUs = 5000;			//PA calibration before first transmission
+  uint32_t retuneUs = 2000;			//PA calibration after channel change
+  uint32_t groupUs = 87600;			//one RDS group, 104 bits at 1187.5 bit/s
+};
+
+struct QN8027SimTransaction
+{
+  uint64_t timeUs;
+  bool read;
+  uint8_t reg;						//register pointer at start
+  uint8_t len;						//data bytes, without register address of a write
+  uint8_t data[QN8027_SIM_REGS + 1];
+};
+
+struct QN8027SimGroup
+{
+  uint64_t timeUs;					//group boundary chip took it at
+  uint8_t data[8];
+};
+
+//input level, from atMs on until next point
+struct QN8027SimLevel
+{
+  uint32_t atMs;
+  uint16_t mV;
+};
+
+class QN8027Sim : public I2CDevice
+{
+private:
+  uint8_t _regs[QN8027_SIM_REGS];
+  uint8_t _pointer = 0;
+  uint8_t _fsm = SIM_FSM_RECALIBRATING;
+  uint64_t _fsmDueUs = QN8027_SIM_NO_EVENT;	//end of a passing state
+  uint64_t _nowUs = 0;						//model time, follows virtual clock
+  uint64_t _txStartUs = 0;					//RDS group clock starts with transmission
+
+  uint8_t _rdsToggle = 0;						//STATUS_REG bit 3
+  uint8_t _takenRdy = 0;						//SYSTEM_REG RDSRDY bit of last group taken
+  bool _groupPending = false;
+  uint64_t _latchUs = 0;
+
+  std::vector<QN8027SimLevel> _script;
+  size_t _scriptPos = 0;						//first point not applied yet
+  uint16_t _levelMv = 0;
+  uint16_t _peakMv = 0;						//highest level since peak was cleared
+  uint64_t _silentSinceUs = 0;
+
+  std::vector<QN8027SimTransaction> _log;
+  std::vector<QN8027SimGroup> _groups;
+
+  void setDefaults();
+  void enterState(uint8_t state);
+  void passState(uint8_t state,uint32_t forUs);
+  void stateDone();
+  void channelChanged();
+  uint8_t regValue(uint8_t addr);
+  void writeReg(uint8_t addr,uint8_t value);
+  void applyLevel(uint16_t mV);
+  uint64_t nextBoundary();
+  uint64_t autoOffDue();
+  void advance(uint64_t nowUs);
+  void logTransaction(bool read,uint8_t reg,const uint8_t *data,size_t len);
+
+public:
+  QN8027SimTiming timing;
+  uint8_t nackNext = 0;				//NACK this many next transactions, for error handling tests
+
+  uint32_t resets = 0;				//SWRST
+  uint32_t recalibrations = 0;		//RECAL
+  uint32_t retunes = 0;				//channel changed while on air
+  uint32_t paOffs = 0;				//PA switched off by silence timer
+  uint32_t rdsLatches = 0;			//RDSRDY toggles seen
+  uint32_t rdsOverruns = 0;			//RDSRDY toggled back before chip took the group
+  uint32_t droppedLog = 0;			//transactions over QN8027_SIM_LOG_MAX
+
+  QN8027Sim();
+  void powerOn();
+
+  bool i2cWrite(const uint8_t *data,size_t len) override;
+  size_t i2cRead(uint8_t *data,size_t len) override;
+
+  uint8_t reg(uint8_t addr);
+  uint8_t fsm();
+  uint16_t channel();					//10 kHz units, 8810 == 88.1 MHz
+  bool onAir();
+
+  void setInputMv(uint16_t mV);
+  void setInputScript(const QN8027SimLevel *levels,size_t count);
+  uint8_t peakNibble(uint16_t mV);
+
+  const std::vector<QN8027SimTransaction> &transactions() { return _log; }
+  const std::vector<QN8027SimGroup> &groups() { return _groups; }
+  void clearLog();
+  void printLog(FILE *out);
+};
+
+#endif
@@ -1,6 +1,7 @@
 #include <Arduino.h>
 #include <Wire.h>
 #include <QN8027Radio.h>
+#include <I2CBus.h>
 #include <WiFi.h>
 #include <AsyncTCP.h>
 #include <ESPAsyncWebServer.h>
@@ -9,6 +10,17 @@
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
 #include <Preferences.h>
+#include <esp_timer.h>
+#include <BinaryFrame.h>
+
+// I2C总线：QN8027和OLED共用，所有任务都通过总线仲裁器访问
+#define I2C_SDA        8
+#define I2C_SCL        9
+#define I2C_CLOCK_HZ   100000
+#define OLED_CLOCK_HZ  400000     // 只在发送OLED数据时使用
+#define OLED_CHUNK     64         // 每次传输的显示数据字节数（Wire缓冲区128字节）
+I2CBus bus(Wire);
+uint8_t busRds, busStatus, busControl, busOled;
 
 // OLED显示屏设置
 #define SCREEN_WIDTH 128
@@ -17,17 +29,68 @@
 #define SCREEN_ADDRESS 0x3C
 Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
 
+// 显示字段，每个字段占一行（8像素，正好一页），只重画和发送内容变化的页
+enum DisplayField { FIELD_FREQ, FIELD_STATION, FIELD_POWER, FIELD_STATUS, FIELD_COUNT };
+const uint8_t fieldPage[FIELD_COUNT] = {0, 2, 4, 6};
+struct ShownFields {
+  uint16_t freq10k;
+  String stationName;
+  int txPower;
+  uint8_t fsm;
+};
+ShownFields shown;
+bool shownValid = false;                  // false时下次全屏重画（启动画面、WiFi画面之后）
+uint32_t oledBytesFlushed = 0;            // 发送到OLED的总字节数
+uint32_t oledBytesPerSec = 0;
+
+// 音量表：状态任务每次采样的音频峰值（STATUS_REG bit7:4，0-15，x45mV）画在第7页
+#define METER_PAGE       7
+#define METER_SEGMENT    8          // 每级8像素，15级120像素
+#define METER_HOLD_MS    1500       // 峰值保持时间
+uint8_t meterLevel = 0;             // 条形长度，上升立即跟随，下降每帧一级
+uint8_t meterHold = 0;              // 峰值保持位置
+unsigned long meterHoldAt = 0;
+uint8_t meterShownLevel = 0xFF;     // 屏幕上当前画的内容，0xFF == 需要重画
+uint8_t meterShownHold = 0xFF;
+
 // FM发射机
 QN8027Radio radio = QN8027Radio();
 uint8_t fsmStatus;
 String stats[] = {"Resetting", "Recalibrating", "Idle", "TxReady", "PACalib", "Transmiting", "PA Off"};
 
+// I2C记录：QN8027的每次传输（时间、地址、寄存器、数据、结果）记入环形缓冲区
+// 现场出问题时用trace命令或/api/trace下载，在电脑上重放到QN8027模型（NATIVE_REPLAY，见native/NativeBoard）
+#define TRACE_DEFAULT_KB   16
+#define TRACE_MAX_KB       64
+#define TRACE_COPY_MARGIN  512      // 复制期间还在记录，多留一些空间
+#define TRACE_LINE_BYTES   32       // 串口输出每行字节数
+QN8027Trace i2cTrace;
+
 // WiFi设置
 const char* default_ssid = "xxxxxxxxxx";
 const char* default_password = "xxxxxxxxx";
 const char* ap_ssid = "FM_Transmitter_AP";
 const char* ap_password = "12345678";
 
+// WiFi状态机：事件回调只置标志，loop中的serviceWiFi()处理，从不阻塞发射
+enum WiFiState { WIFI_STA_CONNECTING, WIFI_STA_CONNECTED, WIFI_STA_BACKOFF };
+WiFiState wifiState = WIFI_STA_CONNECTING;
+volatile bool wifiGotIP = false;          // 由WiFi事件任务设置
+volatile bool wifiLost = false;
+bool apActive = false;                    // AP热点已开启（STA仍在后台重连）
+unsigned long wifiAttemptAt = 0;          // 本次连接尝试开始时间
+unsigned long wifiRetryAt = 0;            // 退避结束时间
+unsigned long wifiDownSince = 0;          // 开始没有STA连接的时间
+uint32_t wifiBackoffMs = 0;
+uint32_t wifiReconnects = 0;
+unsigned long displayHoldUntil = 0;       // WiFi提示画面显示到此时间
+
+#define WIFI_CONNECT_TIMEOUT_MS  10000    // 一次STA连接尝试的最长时间
+#define WIFI_BACKOFF_MIN_MS      1000     // 重连退避，每次失败加倍
+#define WIFI_BACKOFF_MAX_MS      60000
+#define WIFI_AP_FALLBACK_MS      10000    // 失去STA连接这么久后开启AP热点
+#define WIFI_SCREEN_MS           2000
+
 // Web服务器
 AsyncWebServer server(80);
 
@@ -35,7 +98,9 @@ AsyncWebServer server(80);
 Preferences preferences;
 
 // 设置变量
-float frequency = 88.0;
+// 频率以10kHz为单位（8800 == 88.00 MHz），全程整数运算，ESP32-C3没有FPU
+#define FM_CHANNEL_PLAN QN8027_PLAN_FULL
+uint16_t freq10k = 8800;
 int txFreqDeviation = 150;
 bool rdsEnabled = true;
 String stationName = "QN8027FM";
@@ -43,23 +108,169 @@ String radioText = "Welcome to FM transmitter";
 bool monoAudio = false;
 int txPower = 75;
 bool preEmphTime50 = true;
+bool agcEnabled = false;          // 自动音量控制和频偏限制（由状态任务的采样驱动）
+uint8_t rdsMix = RDS_DEFAULT_PS_PER_SEC;  // 电台名称每秒发送组数（不保存）
+
+// 静音检测：峰值低于silenceThreshold持续silenceHoldMs判定为静音，
+// 静音时RDS文本换成fallbackText（可选同时静音输出），峰值恢复并持续silenceRecoverMs后恢复
+uint8_t silenceThreshold = 1;     // 音频峰值（0-15，x45mV）
+uint32_t silenceHoldMs = 5000;
+uint32_t silenceRecoverMs = 1000;
+#define SILENCE_MS_MAX 3600000L   // 判定和恢复时间1 ms - 1小时，串口、二进制协议和网页都用这个范围
+bool silenceMute = false;
+String fallbackText = "Audio interrupted, please stay tuned";
+bool audioSilent = false;
+bool silenceMuted = false;        // 静音时由这里打开了mute
+unsigned long quietSince = 0;     // 峰值开始低于阈值的时间
+unsigned long loudSince = 0;      // 静音期间峰值开始恢复的时间
+unsigned long silentSince = 0;
+
+// 静音和恢复事件记录（RAM环形缓冲区，串口events命令和/api/events查看）
+#define EVENT_LOG_LEN 32
+enum AudioEventType { EVENT_SILENCE, EVENT_RECOVERY };
+const char* audioEventNames[] = {"silence", "recovery"};
+struct AudioEvent {
+  uint32_t timeMs;                // 发生时间（上电后毫秒数）
+  uint8_t type;
+  uint8_t peak;
+  uint32_t durationMs;            // 之前的有声/静音持续了多久
+};
+AudioEvent eventLog[EVENT_LOG_LEN];
+uint32_t eventCount = 0;          // 总事件数，最近EVENT_LOG_LEN个保存在eventLog中
+
+// 任务划分：RDS发送 > 状态采样 > 显示 > 控制（串口、WiFi、Web设置，就是Arduino的loop，优先级1）
+// RDS任务优先级高于async_tcp(3)，慢的HTTP请求或很长的串口命令都不会推迟RDS组
+#define RDS_TASK_PRIORITY      5
+#define STATUS_TASK_PRIORITY   4
+#define DISPLAY_TASK_PRIORITY  2
+
+#define LOOP_INTERVAL_MS   10   // RDS最长休眠时间，一组RDS约87.6ms
+#define STATUS_SAMPLE_MS   40   // 状态采样周期（25Hz），FSM检查和音量表共用一次读取
+#define REWRITE_RETRY_MS   1000 // 设置寄存器重写失败后，隔这么久再试（每次失败要占用stateMutex一个重试预算）
+#define DISPLAY_REFRESH_MS 1000
+#define CONTROL_INTERVAL_MS 10
+
+// 每个任务的唤醒延迟（实际唤醒时间 - 应该唤醒的时间）
+enum AppTask { TASK_RDS, TASK_STATUS, TASK_DISPLAY, TASK_CONTROL, TASK_COUNT };
+struct TaskStats {
+  const char* name;
+  TaskHandle_t handle;
+  uint32_t wakeups;
+  uint32_t lastLatencyUs;
+  uint32_t maxLatencyUs;
+};
+TaskStats taskStats[TASK_COUNT] = {{"rds"}, {"status"}, {"display"}, {"control"}};
+
+SemaphoreHandle_t stateMutex;     // 保护radio对象和上面的设置变量，持有时间很短，不做I2C以外的慢操作
+QueueHandle_t statusQueue;        // 最新STATUS快照（长度1，覆盖写）
+QueueHandle_t displayQueue;       // 重绘请求
+QueueHandle_t settingsQueue;      // Web提交的设置，由控制任务应用和保存
 
-// 定时器
-unsigned long lastDisplayUpdate = 0;
-unsigned long lastRdsUpdate = 0;
+enum DisplayRequestType { DISPLAY_REFRESH, DISPLAY_WIFI, DISPLAY_METER };
+struct DisplayRequest {
+  uint8_t type;
+  uint8_t value;                  // DISPLAY_METER: 音频峰值
+  uint32_t postedUs;
+};
+
+struct WebSettings {
+  uint16_t freq10k;
+  int txFreqDeviation;
+  bool rdsEnabled;
+  char stationName[RDS_PS_CHARS + 1];
+  char radioText[RDS_RT_CHARS + 1];
+  bool monoAudio;
+  int txPower;
+  bool preEmphTime50;
+  bool agcEnabled;
+  uint8_t silenceThreshold;
+  uint32_t silenceHoldMs;
+  uint32_t silenceRecoverMs;
+  bool silenceMute;
+  char fallbackText[RDS_RT_CHARS + 1];
+};
+
+// 启动阶段时间戳（上电后的微秒数），用于测量上电到载波发射的时间
+enum BootPhase { BOOT_SETUP, BOOT_RADIO_RESET, BOOT_IMAGE, BOOT_SETTINGS, BOOT_OLED, BOOT_WIFI, BOOT_WEB, BOOT_CARRIER, BOOT_PHASES };
+const char* bootPhaseNames[BOOT_PHASES] = {"setup", "radio reset", "reg image", "settings", "oled", "wifi", "web", "carrier"};
+uint32_t bootUs[BOOT_PHASES];
+bool fastBoot = false;                  // 本次启动使用了保存的寄存器镜像
+#define BOOT_CARRIER_BUDGET_MS  300     // 上电到载波发射的时间预算
+
+// RDS唤醒定时器：在预测的RDS翻转时刻唤醒RDS任务，避免频繁读取STATUS寄存器
+esp_timer_handle_t rdsWakeTimer;
 
 // 功能声明
+void rdsWakeCallback(void* arg);
+void rdsTask(void* arg);
+void statusTask(void* arg);
+void displayTask(void* arg);
+void lockState();
+void radioBusHook(bool take);
+bool radioBusRecovery();
+void flushDisplay(uint8_t pageMask);
+void drawField(uint8_t field, const String& text);
+void updateFlushRate();
+void printBusStats();
+void unlockState();
+void noteWakeup(AppTask task, long lateUs);
+void requestDisplay(uint8_t type, uint8_t value = 0);
+void drawMeter(uint8_t peak);
+void applyWebSettings();
+void printTaskStats();
+void updateRDSContent();
+void checkSilence(uint8_t peak);
+void logAudioEvent(uint8_t type, uint8_t peak, uint32_t durationMs);
+uint8_t copyAudioEvents(AudioEvent* out);
+void printAudioEvents();
+size_t copyTrace(uint8_t** image);
+void printTrace();
+const char* formatFreq(uint16_t ch10kHz, char* buf);
+long parseFixed(const char* text, uint8_t decimals);
 void setupWiFi();
+void onWiFiEvent(WiFiEvent_t event);
+void serviceWiFi();
+void startWiFiAttempt();
+void showWiFiScreen();
 void setupWebServer();
 void setupOLED();
 void updateDisplay();
 void handleSerialCommands();
+void serviceTelemetry();
 void loadSettings();
 void saveSettings();
+bool loadRegImage();
+void saveRegImage();
+void markBoot(BootPhase phase);
+void printBootTimes();
 
 void setup() {
+  markBoot(BOOT_SETUP);
   Serial.begin(115200);
   
+  stateMutex = xSemaphoreCreateMutex();
+  statusQueue = xQueueCreate(1, sizeof(StatusSnapshot));
+  displayQueue = xQueueCreate(8, sizeof(DisplayRequest));
+  settingsQueue = xQueueCreate(2, sizeof(WebSettings));
+  
+  // 设置I2C针脚，客户端按任务区分以便统计等待时间
+  busRds = bus.addClient("rds");
+  busStatus = bus.addClient("status");
+  busControl = bus.addClient("control");
+  busOled = bus.addClient("oled");
+  bus.begin(I2C_SDA, I2C_SCL, I2C_CLOCK_HZ);
+  radio.setBusHook(radioBusHook);
+  radio.setBusRecovery(radioBusRecovery);   // 从机拉住SDA时用SCL时钟释放总线，不用断电
+  
+  // FM发射机初始化
+  radio.reset();
+  radio.reCalibrate();
+  markBoot(BOOT_RADIO_RESET);
+  
+  // 先把保存的寄存器镜像一次写入芯片，WiFi和Web服务器启动之前就开始发射
+  fastBoot = loadRegImage();
+  markBoot(BOOT_IMAGE);
+  
   // 初始化SPIFFS文件系统
   if(!SPIFFS.begin(true)) {
     Serial.println("SPIFFS初始化失败");
@@ -68,75 +279,402 @@ void setup() {
   // 加载设置
   loadSettings();
   
-  // 设置I2C针脚
-  Wire.begin(8, 9);
+  // 没有寄存器镜像（第一次启动或镜像无效）时按设置逐项配置，并保存镜像
+  if (!fastBoot) {
+    // 应用设置（endUpdate时只把有变化的寄存器以突发方式写入）
+    radio.beginUpdate();
+    radio.setChannel(freq10k);
+    radio.setTxFreqDeviation(txFreqDeviation);
+    radio.setTxPower(txPower);
+    
+    if(preEmphTime50) radio.setPreEmphTime50(ON);
+    if(monoAudio) radio.MonoAudio(ON);
+    
+    radio.Switch(ON);
+    
+    // RDS设置
+    if(rdsEnabled) {
+      radio.RDS(ON);
+    } else {
+      radio.RDS(OFF);
+    }
+    radio.endUpdate();
+    saveRegImage();
+  }
+  radio.setRDSPrediction(ON);
+  radio.setPeakClearPolicy(PEAK_CLEAR_ON_POLL);   // 每次采样得到上次采样以来的峰值
+  radio.setAGC(agcEnabled ? ON : OFF);
+  radio.radioNoAudioAutoOFF(OFF);                 // 静音由固件自己检测，芯片不要关闭载波
+  updateRDSContent();
+  markBoot(BOOT_SETTINGS);
+  
+  // RDS和状态采样任务马上开始运行，不等OLED、WiFi和Web服务器
+  esp_timer_create_args_t timerArgs = {};
+  timerArgs.callback = rdsWakeCallback;
+  timerArgs.name = "rds_wake";
+  esp_timer_create(&timerArgs, &rdsWakeTimer);
+  xTaskCreate(rdsTask, "rds", 3072, NULL, RDS_TASK_PRIORITY, &taskStats[TASK_RDS].handle);
+  xTaskCreate(statusTask, "status", 3072, NULL, STATUS_TASK_PRIORITY, &taskStats[TASK_STATUS].handle);
   
   // 初始化OLED
   setupOLED();
-  
-  // FM发射机初始化
-  radio.reset();
-  radio.reCalibrate();
-  
-  // 应用设置
-  radio.setFrequency(frequency);
-  radio.setTxFreqDeviation(txFreqDeviation);
-  radio.setTxPower(txPower);
-  
-  if(preEmphTime50) radio.setPreEmphTime50(ON);
-  if(monoAudio) radio.MonoAudio(ON);
-  
-  radio.Switch(ON);
-  
-  // RDS设置
-  if(rdsEnabled) {
-    radio.RDS(ON);
-  } else {
-    radio.RDS(OFF);
-  }
+  xTaskCreate(displayTask, "display", 4096, NULL, DISPLAY_TASK_PRIORITY, &taskStats[TASK_DISPLAY].handle);
+  taskStats[TASK_CONTROL].handle = xTaskGetCurrentTaskHandle();
+  markBoot(BOOT_OLED);
   
   // 设置WiFi和Web服务器
   setupWiFi();
+  markBoot(BOOT_WIFI);
   setupWebServer();
+  markBoot(BOOT_WEB);
   
   Serial.println("FM发射机已启动");
   Serial.println("使用'help'命令查看可用指令");
   
   // 显示初始状态
-  updateDisplay();
+  requestDisplay(DISPLAY_REFRESH);
 }
 
+// 控制任务：串口命令、WiFi状态机和Web设置，这里的任何慢操作都不会影响RDS
 void loop() {
-  // 处理串口命令
   handleSerialCommands();
+  serviceTelemetry();
+  serviceWiFi();
+  applyWebSettings();
   
-  // 更新RDS信息
-  if (millis() - lastRdsUpdate > 1000 && rdsEnabled) {
-    radio.sendStationName(stationName);
-    delay(100);
-    radio.sendRadioText(radioText);
-    lastRdsUpdate = millis();
+  uint32_t dueUs = micros() + CONTROL_INTERVAL_MS * 1000UL;
+  vTaskDelay(pdMS_TO_TICKS(CONTROL_INTERVAL_MS));
+  noteWakeup(TASK_CONTROL, (long)(micros() - dueUs));
+}
+
+// 发送RDS（非阻塞，芯片取走上一组后才写入下一组，电台名称和文本已预先编码）
+// 休眠到下一个RDS预测时刻，最长LOOP_INTERVAL_MS
+void rdsTask(void* arg) {
+  for (;;) {
+    lockState();
+    radio.pollRDS();
+    uint32_t wakeUs = radio.rdsWakeDelayUs();
+    unlockState();
+    if (wakeUs == 0 || wakeUs > LOOP_INTERVAL_MS * 1000UL) wakeUs = LOOP_INTERVAL_MS * 1000UL;
+    
+    esp_timer_stop(rdsWakeTimer);
+    esp_timer_start_once(rdsWakeTimer, wakeUs);
+    uint32_t dueUs = micros() + wakeUs;
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    noteWakeup(TASK_RDS, (long)(micros() - dueUs));
   }
-  
-  // 更新显示屏
-  if (millis() - lastDisplayUpdate > 1000) {
-    updateDisplay();
-    lastDisplayUpdate = millis();
+}
+
+void rdsWakeCallback(void* arg) {
+  xTaskNotifyGive(taskStats[TASK_RDS].handle);
+}
+
+// 检查FM状态变化和音频峰值（一次STATUS快照，同时驱动RDS），最新快照放入statusQueue，峰值交给显示任务画音量表
+// 载波开始发射之前每LOOP_INTERVAL_MS检查一次，以便准确记录启动时间
+void statusTask(void* arg) {
+  TickType_t lastWake = xTaskGetTickCount();
+  uint32_t dueUs = micros();
+  unsigned long rewriteFailedAt = 0;
+  bool rewriteFailed = false;
+  for (;;) {
+    lockState();
+    StatusSnapshot st = radio.poll();
+    // 写入失败的设置寄存器在这里重写，直到芯片收到为止。这次读取已经失败或者上次重写失败不到REWRITE_RETRY_MS时不重写，
+    // 芯片没有应答时每个周期最多占用stateMutex一个重试预算，RDS和控制任务不会被一直挡住
+    bool rewriteDue = !rewriteFailed || millis() - rewriteFailedAt >= REWRITE_RETRY_MS;
+    if (radio.lastError == 0 && rewriteDue && radio.writesPending()) {
+      rewriteFailed = !radio.flush();
+      rewriteFailedAt = millis();
+    }
+    unlockState();
+    xQueueOverwrite(statusQueue, &st);
+    requestDisplay(DISPLAY_METER, st.audioPeak);
+    checkSilence(st.audioPeak);
+    
+    if(st.fsm == FSM_TRANSMITTING && bootUs[BOOT_CARRIER] == 0) {
+      markBoot(BOOT_CARRIER);
+      printBootTimes();
+    }
+    if(st.fsm != fsmStatus) {
+      fsmStatus = st.fsm;
+      Serial.print("FSM模式已更改:");
+      Serial.println(stats[fsmStatus]);
+      requestDisplay(DISPLAY_REFRESH);
+    }
+    
+    uint32_t periodMs = bootUs[BOOT_CARRIER] == 0 ? LOOP_INTERVAL_MS : STATUS_SAMPLE_MS;
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(periodMs));
+    dueUs += periodMs * 1000UL;
+    if ((long)(micros() - dueUs) > (long)(periodMs * 1000UL)) dueUs = micros();  // 错过整周期后重新对齐
+    noteWakeup(TASK_STATUS, (long)(micros() - dueUs));
   }
-  
-  // 检查FM状态变化
-  if(radio.getFSMStatus() != fsmStatus) {
-    fsmStatus = radio.getFSMStatus();
-    Serial.print("FSM模式已更改:");
-    Serial.println(stats[fsmStatus]);
+}
+
+// 显示任务：处理重绘请求，没有请求时每DISPLAY_REFRESH_MS刷新一次
+void displayTask(void* arg) {
+  uint32_t dueUs = micros() + DISPLAY_REFRESH_MS * 1000UL;
+  for (;;) {
+    DisplayRequest req;
+    long waitUs = (long)(dueUs - micros());
+    if (waitUs < 0) waitUs = 0;
+    if (xQueueReceive(displayQueue, &req, pdMS_TO_TICKS(waitUs / 1000)) == pdTRUE) {
+      noteWakeup(TASK_DISPLAY, (long)(micros() - req.postedUs));
+      if (req.type == DISPLAY_METER) {
+        drawMeter(req.value);
+        continue;
+      }
+      if (req.type == DISPLAY_WIFI) {
+        showWiFiScreen();
+        dueUs = micros() + WIFI_SCREEN_MS * 1000UL;
+        continue;
+      }
+      if ((long)(millis() - displayHoldUntil) < 0) continue;   // WiFi画面显示期间不刷新
+    } else {
+      noteWakeup(TASK_DISPLAY, (long)(micros() - dueUs));
+    }
     updateDisplay();
+    updateFlushRate();
+    dueUs = micros() + DISPLAY_REFRESH_MS * 1000UL;
+  }
+}
+
+void lockState() {
+  xSemaphoreTake(stateMutex, portMAX_DELAY);
+}
+
+void unlockState() {
+  xSemaphoreGive(stateMutex);
+}
+
+// QN8027的每次I2C传输都经过这里，按调用任务选择总线客户端
+void radioBusHook(bool take) {
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  uint8_t client = busControl;
+  if (self == taskStats[TASK_RDS].handle) client = busRds;
+  else if (self == taskStats[TASK_STATUS].handle) client = busStatus;
+  if (take) {
+    bus.acquire(client);
+  } else {
+    bus.release(client);
+  }
+}
+
+// QN8027传输失败（不是NACK）后在占用总线期间调用
+bool radioBusRecovery() {
+  return bus.recover();
+}
+
+// 按页（128字节）发送显示缓冲区，代替display.display()一次占用总线发送1KB
+// 每页单独占用总线，页与页之间RDS任务可以插入
+void flushDisplay(uint8_t pageMask) {
+  uint8_t* buf = display.getBuffer();
+  for (uint8_t page = 0; page < SCREEN_HEIGHT / 8; page++) {
+    if (!(pageMask & (1 << page))) continue;
+    bus.acquire(busOled);
+    Wire.setClock(OLED_CLOCK_HZ);
+    Wire.beginTransmission(SCREEN_ADDRESS);
+    Wire.write((uint8_t)0x00);            // 后面都是命令
+    Wire.write((uint8_t)SSD1306_PAGEADDR);
+    Wire.write(page);
+    Wire.write(page);
+    Wire.write((uint8_t)SSD1306_COLUMNADDR);
+    Wire.write((uint8_t)0);
+    Wire.write((uint8_t)(SCREEN_WIDTH - 1));
+    Wire.endTransmission();
+    for (uint8_t col = 0; col < SCREEN_WIDTH; col += OLED_CHUNK) {
+      Wire.beginTransmission(SCREEN_ADDRESS);
+      Wire.write((uint8_t)0x40);          // 后面都是显示数据
+      Wire.write(buf + page * SCREEN_WIDTH + col, OLED_CHUNK);
+      Wire.endTransmission();
+    }
+    Wire.setClock(I2C_CLOCK_HZ);
+    bus.release(busOled);
+    oledBytesFlushed += 8 + SCREEN_WIDTH + SCREEN_WIDTH / OLED_CHUNK;
+  }
+}
+
+// 每秒计算一次OLED发送速率
+void updateFlushRate() {
+  static unsigned long rateStart = 0;
+  static uint32_t rateBytes = 0;
+  unsigned long elapsed = millis() - rateStart;
+  if (elapsed < 1000) return;
+  oledBytesPerSec = (uint64_t)(oledBytesFlushed - rateBytes) * 1000 / elapsed;
+  rateBytes = oledBytesFlushed;
+  rateStart = millis();
+}
+
+void printBusStats() {
+  Serial.println("I2C总线: 占用次数, 等待次数, 上次等待, 最大等待, 平均等待, 最长占用");
+  for (uint8_t i = 0; i < bus.clientCount(); i++) {
+    const I2CBusClient& c = bus.client(i);
+    uint32_t avgUs = c.acquisitions ? (uint32_t)(c.totalWaitUs / c.acquisitions) : 0;
+    Serial.println("  " + String(c.name) + ": " + String(c.acquisitions) + ", " + String(c.contended) + ", " +
+                   String(c.lastWaitUs) + " us, " + String(c.maxWaitUs) + " us, " + String(avgUs) + " us, " +
+                   String(c.maxHoldUs) + " us");
+  }
+  Serial.println("总线恢复: " + String(bus.recoveries) + " 次, 失败 " + String(bus.recoveryFailures) + " 次");
+  String regText;
+  for (uint8_t reg = 0; reg < QN8027_REG_COUNT; reg++) {
+    if (radio.regErrors[reg] == 0) continue;
+    char item[16];
+    snprintf(item, sizeof(item), " %02X:%u", reg, radio.regErrors[reg]);
+    regText += item;
+  }
+  Serial.println("寄存器错误:" + (regText.length() ? regText : String(" 无")));
+}
+
+void noteWakeup(AppTask task, long lateUs) {
+  TaskStats& t = taskStats[task];
+  t.lastLatencyUs = lateUs > 0 ? lateUs : 0;
+  if (t.lastLatencyUs > t.maxLatencyUs) t.maxLatencyUs = t.lastLatencyUs;
+  t.wakeups++;
+}
+
+void requestDisplay(uint8_t type, uint8_t value) {
+  DisplayRequest req = {type, value, (uint32_t)micros()};
+  xQueueSend(displayQueue, &req, 0);     // 队列满时已经有重绘在等待，丢弃即可
+}
+
+void printTaskStats() {
+  Serial.println("任务: 唤醒次数, 上次延迟, 最大延迟, 剩余栈");
+  for (int i = 0; i < TASK_COUNT; i++) {
+    TaskStats& t = taskStats[i];
+    Serial.println("  " + String(t.name) + ": " + String(t.wakeups) + ", " + String(t.lastLatencyUs) + " us, " +
+                   String(t.maxLatencyUs) + " us, " + String(t.handle ? uxTaskGetStackHighWaterMark(t.handle) : 0));
   }
-  
-  delay(100);
+}
+
+// 电台名称和文本只在内容变化时重新编码，RDS任务循环发送。静音期间发送fallbackText
+void updateRDSContent() {
+  lockState();
+  if (rdsEnabled) {
+    radio.sendStationName(stationName);
+    radio.sendRadioText(audioSilent ? fallbackText : radioText);
+  } else {
+    radio.clearRDSQueue();
+  }
+  unlockState();
+  if (taskStats[TASK_RDS].handle) xTaskNotifyGive(taskStats[TASK_RDS].handle);   // 新内容马上开始发送
+}
+
+// 状态任务每次采样调用，峰值来自PEAK_CLEAR_ON_POLL，即上次采样以来的最大值
+void checkSilence(uint8_t peak) {
+  unsigned long now = millis();
+  if (!audioSilent) {
+    if (peak >= silenceThreshold) {
+      quietSince = now;
+      return;
+    }
+    if (now - quietSince < silenceHoldMs) return;
+    
+    lockState();
+    audioSilent = true;
+    silentSince = now;
+    loudSince = now;
+    logAudioEvent(EVENT_SILENCE, peak, now - quietSince);
+    if (silenceMute) {
+      radio.mute(ON);
+      silenceMuted = true;
+    }
+    unlockState();
+    updateRDSContent();
+    Serial.println("检测到静音，RDS文本已切换为备用文本");
+  } else {
+    if (peak < silenceThreshold) {
+      loudSince = now;
+      return;
+    }
+    if (now - loudSince < silenceRecoverMs) return;
+    
+    lockState();
+    audioSilent = false;
+    quietSince = now;
+    logAudioEvent(EVENT_RECOVERY, peak, now - silentSince);
+    if (silenceMuted) {
+      radio.mute(OFF);
+      silenceMuted = false;
+    }
+    unlockState();
+    updateRDSContent();
+    Serial.println("音频已恢复，静音 " + String((now - silentSince) / 1000) + " 秒");
+  }
+}
+
+// 调用者持有stateMutex
+void logAudioEvent(uint8_t type, uint8_t peak, uint32_t durationMs) {
+  AudioEvent& e = eventLog[eventCount % EVENT_LOG_LEN];
+  e.timeMs = millis();
+  e.type = type;
+  e.peak = peak;
+  e.durationMs = durationMs;
+  eventCount++;
+}
+
+// 按时间顺序复制最近的事件，返回个数
+uint8_t copyAudioEvents(AudioEvent* out) {
+  lockState();
+  uint8_t count = eventCount < EVENT_LOG_LEN ? eventCount : EVENT_LOG_LEN;
+  for (uint8_t i = 0; i < count; i++) {
+    out[i] = eventLog[(eventCount - count + i) % EVENT_LOG_LEN];
+  }
+  unlockState();
+  return count;
+}
+
+void printAudioEvents() {
+  AudioEvent events[EVENT_LOG_LEN];
+  uint8_t count = copyAudioEvents(events);
+  Serial.println("音频事件 (共 " + String(eventCount) + " 个, 当前" + String(audioSilent ? "静音" : "有声") + "):");
+  for (uint8_t i = 0; i < count; i++) {
+    Serial.println("  " + String(events[i].timeMs / 1000) + "." + String(events[i].timeMs % 1000 / 100) + " s " +
+                   audioEventNames[events[i].type] + ", 峰值 " + String(events[i].peak) +
+                   ", 之前持续 " + String(events[i].durationMs) + " ms");
+  }
+}
+
+// I2C记录复制到新分配的缓冲区（调用者free），还没有记录或内存不足时返回0
+size_t copyTrace(uint8_t** image) {
+  *image = NULL;
+  if (i2cTrace.capacity() == 0) return 0;
+  size_t maxLen = i2cTrace.imageSize() + TRACE_COPY_MARGIN;
+  *image = (uint8_t*)malloc(maxLen);
+  if (*image == NULL) return 0;
+  size_t len = i2cTrace.copy(*image, maxLen);
+  if (len == 0) {
+    free(*image);
+    *image = NULL;
+  }
+  return len;
+}
+
+// 十六进制输出，每行以':'开头，保存到文件后可以直接重放
+void printTrace() {
+  uint8_t* image = NULL;
+  size_t len = copyTrace(&image);
+  if (len == 0) {
+    Serial.println("没有I2C记录，先用'trace on'开始记录");
+    return;
+  }
+  Serial.println("I2C记录 " + String((unsigned long)len) + " 字节:");
+  char line[2 * TRACE_LINE_BYTES + 2];
+  for (size_t pos = 0; pos < len; pos += TRACE_LINE_BYTES) {
+    char* p = line;
+    *p++ = ':';
+    for (size_t i = pos; i < len && i < pos + TRACE_LINE_BYTES; i++) {
+      p += sprintf(p, "%02X", image[i]);
+    }
+    Serial.println(line);
+  }
+  free(image);
 }
 
 void setupOLED() {
-  if(!display.begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDRESS)) {
+  // Wire已由总线仲裁器初始化，不让库再次初始化
+  bus.acquire(busOled);
+  bool found = display.begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDRESS, true, false);
+  bus.release(busOled);
+  if(!found) {
     Serial.println("SSD1306初始化失败");
   } else {
     display.clearDisplay();
@@ -144,85 +682,190 @@ void setupOLED() {
     display.setTextColor(SSD1306_WHITE);
     display.setCursor(0, 0);
     display.println("FM发射机初始化中...");
-    display.display();
+    flushDisplay(0xFF);
   }
 }
 
+// 只在显示任务中调用。先在锁内复制要显示的内容，画图和I2C传输都在锁外
+// 只重画内容变化的字段，只发送这些字段所在的页，内容都没变时不占用总线
 void updateDisplay() {
-  display.clearDisplay();
+  lockState();
+  ShownFields now = {freq10k, stationName, txPower, 0};
+  unlockState();
+  StatusSnapshot st = {};
+  xQueuePeek(statusQueue, &st, 0);
+  now.fsm = st.fsm;
+  
+  uint8_t dirtyPages = 0;
+  if (!shownValid) {
+    display.clearDisplay();
+    dirtyPages = 0xFF;
+    meterShownLevel = 0xFF;               // 音量表下一帧重画
+  }
   display.setTextSize(1);
   display.setTextColor(SSD1306_WHITE);
+  display.setTextWrap(false);             // 文字不能换行到别的字段的页
   
   // 频率显示
-  display.setCursor(0, 0);
-  display.print("FM: ");
-  display.print(frequency);
-  display.println(" MHz");
+  if (!shownValid || now.freq10k != shown.freq10k) {
+    char freqText[8];
+    drawField(FIELD_FREQ, "FM: " + String(formatFreq(now.freq10k, freqText)) + " MHz");
+    dirtyPages |= 1 << fieldPage[FIELD_FREQ];
+  }
   
   // 电台名称
-  display.setCursor(0, 16);
-  display.print("Station: ");
-  display.println(stationName);
+  if (!shownValid || now.stationName != shown.stationName) {
+    drawField(FIELD_STATION, "Station: " + now.stationName);
+    dirtyPages |= 1 << fieldPage[FIELD_STATION];
+  }
   
   // 发射功率
-  display.setCursor(0, 32);
-  display.print("Power: ");
-  display.print(txPower);
-  display.println("%");
+  if (!shownValid || now.txPower != shown.txPower) {
+    drawField(FIELD_POWER, "Power: " + String(now.txPower) + "%");
+    dirtyPages |= 1 << fieldPage[FIELD_POWER];
+  }
   
   // 状态
-  display.setCursor(0, 48);
-  display.print("Status: ");
-  display.println(stats[radio.getFSMStatus()]);
+  if (!shownValid || now.fsm != shown.fsm) {
+    drawField(FIELD_STATUS, "Status: " + stats[now.fsm]);
+    dirtyPages |= 1 << fieldPage[FIELD_STATUS];
+  }
+  
+  shown = now;
+  shownValid = true;
+  if (dirtyPages) flushDisplay(dirtyPages);
+}
+
+// 音量表，每帧最多发送一页（第7页），内容没变（比如没有音频）时不占用总线
+void drawMeter(uint8_t peak) {
+  unsigned long now = millis();
+  if (peak >= meterLevel) {
+    meterLevel = peak;
+  } else {
+    meterLevel--;
+  }
+  if (peak >= meterHold || now - meterHoldAt > METER_HOLD_MS) {
+    meterHold = peak;
+    meterHoldAt = now;
+  }
+  if (!shownValid || (long)(millis() - displayHoldUntil) < 0) return;   // 其他画面显示期间不画
+  if (meterLevel == meterShownLevel && meterHold == meterShownHold) return;
   
-  display.display();
+  int16_t y = METER_PAGE * 8;
+  display.fillRect(0, y, SCREEN_WIDTH, 8, SSD1306_BLACK);
+  for (uint8_t i = 0; i < meterLevel; i++) {
+    display.fillRect(i * METER_SEGMENT, y + 2, METER_SEGMENT - 2, 5, SSD1306_WHITE);
+  }
+  if (meterHold > 0) {
+    display.fillRect((meterHold - 1) * METER_SEGMENT, y, METER_SEGMENT - 2, 8, SSD1306_WHITE);
+  }
+  meterShownLevel = meterLevel;
+  meterShownHold = meterHold;
+  flushDisplay(1 << METER_PAGE);
+}
+
+// 清除字段所在的一页并写入新内容
+void drawField(uint8_t field, const String& text) {
+  int16_t y = fieldPage[field] * 8;
+  display.fillRect(0, y, SCREEN_WIDTH, 8, SSD1306_BLACK);
+  display.setCursor(0, y);
+  display.print(text);
 }
 
+// 只注册事件并发起第一次连接，立即返回
 void setupWiFi() {
+  WiFi.onEvent(onWiFiEvent);
+  WiFi.setAutoReconnect(false);           // 重连由serviceWiFi()按退避时间控制
   WiFi.mode(WIFI_STA);
+  wifiDownSince = millis();
+  startWiFiAttempt();
+}
+
+// 运行在WiFi事件任务中，只记录事件
+void onWiFiEvent(WiFiEvent_t event) {
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      wifiGotIP = true;
+      break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+    case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+      wifiLost = true;
+      break;
+    default:
+      break;
+  }
+}
+
+void startWiFiAttempt() {
+  Serial.println("正在连接到WiFi...");
   WiFi.begin(default_ssid, default_password);
+  wifiState = WIFI_STA_CONNECTING;
+  wifiAttemptAt = millis();
+}
+
+void serviceWiFi() {
+  if (wifiGotIP) {
+    wifiGotIP = false;
+    wifiLost = false;
+    wifiState = WIFI_STA_CONNECTED;
+    wifiBackoffMs = 0;
+    if (apActive) {
+      WiFi.softAPdisconnect(true);
+      WiFi.mode(WIFI_STA);
+      apActive = false;
+    }
+    Serial.print("已连接WiFi，IP地址: ");
+    Serial.println(WiFi.localIP());
+    requestDisplay(DISPLAY_WIFI);
+  }
   
-  Serial.println("正在连接到WiFi...");
-  display.clearDisplay();
-  display.setTextSize(1);
-  display.setCursor(0, 0);
-  display.println("Connecting WiFi...");
-  display.display();
+  if (wifiLost) {
+    wifiLost = false;
+    if (wifiState == WIFI_STA_CONNECTED) {
+      Serial.println("WiFi连接已断开");
+      wifiDownSince = millis();
+      wifiReconnects++;
+    }
+    if (wifiState != WIFI_STA_BACKOFF) {
+      wifiState = WIFI_STA_BACKOFF;
+      wifiBackoffMs = wifiBackoffMs == 0 ? WIFI_BACKOFF_MIN_MS : min((uint32_t)WIFI_BACKOFF_MAX_MS, wifiBackoffMs * 2);
+      wifiRetryAt = millis() + wifiBackoffMs;
+    }
+  }
   
-  // 等待10秒钟尝试连接
-  unsigned long startAttemptTime = millis();
-  while (WiFi.status() != WL_CONNECTED && millis() - startAttemptTime < 10000) {
-    delay(500);
-    Serial.print(".");
+  if (wifiState == WIFI_STA_CONNECTING && millis() - wifiAttemptAt >= WIFI_CONNECT_TIMEOUT_MS) {
+    WiFi.disconnect();                    // 尝试超时，按断开处理
+    wifiLost = true;
   }
   
-  // 如果连接成功
-  if(WiFi.status() == WL_CONNECTED) {
-    Serial.println("");
-    Serial.print("已连接WiFi，IP地址: ");
-    Serial.println(WiFi.localIP());
-    
-    display.clearDisplay();
-    display.setCursor(0, 0);
+  if (wifiState == WIFI_STA_BACKOFF && (long)(millis() - wifiRetryAt) >= 0) {
+    startWiFiAttempt();
+  }
+  
+  // 长时间没有STA连接时开启AP热点，STA继续在后台重连
+  if (wifiState != WIFI_STA_CONNECTED && !apActive && millis() - wifiDownSince >= WIFI_AP_FALLBACK_MS) {
+    Serial.println("无法连接WiFi，创建接入点...");
+    WiFi.mode(WIFI_AP_STA);
+    WiFi.softAP(ap_ssid, ap_password);
+    apActive = true;
+    Serial.print("接入点已创建，IP: ");
+    Serial.println(WiFi.softAPIP());
+    requestDisplay(DISPLAY_WIFI);
+  }
+}
+
+// WiFi连接信息画面（只在显示任务中调用），显示WIFI_SCREEN_MS后由定时刷新恢复正常画面
+void showWiFiScreen() {
+  display.clearDisplay();
+  display.setTextSize(1);
+  display.setTextColor(SSD1306_WHITE);
+  display.setCursor(0, 0);
+  if (wifiState == WIFI_STA_CONNECTED) {
     display.println("WiFi Connected!");
     display.setCursor(0, 16);
     display.print("IP: ");
     display.println(WiFi.localIP());
-    display.display();
-    delay(2000);
   } else {
-    // 如果连接失败，创建AP
-    Serial.println("无法连接WiFi，创建接入点...");
-    WiFi.disconnect();
-    delay(1000);
-    WiFi.mode(WIFI_AP);
-    WiFi.softAP(ap_ssid, ap_password);
-    
-    Serial.print("接入点已创建，IP: ");
-    Serial.println(WiFi.softAPIP());
-    
-    display.clearDisplay();
-    display.setCursor(0, 0);
     display.println("AP Created");
     display.setCursor(0, 16);
     display.print("SSID: ");
@@ -233,9 +876,10 @@ void setupWiFi() {
     display.setCursor(0, 48);
     display.print("IP: ");
     display.println(WiFi.softAPIP());
-    display.display();
-    delay(2000);
   }
+  flushDisplay(0xFF);
+  shownValid = false;                     // 画面被覆盖，恢复时全屏重画
+  displayHoldUntil = millis() + WIFI_SCREEN_MS;
 }
 
 void setupWebServer() {
@@ -256,7 +900,9 @@ void setupWebServer() {
   // API端点 - 获取当前设置
   server.on("/api/settings", HTTP_GET, [](AsyncWebServerRequest *request) {
     DynamicJsonDocument doc(1024);
-    doc["frequency"] = frequency;
+    char freqText[8];
+    lockState();
+    doc["frequency"] = serialized(formatFreq(freq10k, freqText));   // 直接输出数字文本，不经过float
     doc["txFreqDeviation"] = txFreqDeviation;
     doc["rdsEnabled"] = rdsEnabled;
     doc["stationName"] = stationName;
@@ -264,6 +910,13 @@ void setupWebServer() {
     doc["monoAudio"] = monoAudio;
     doc["txPower"] = txPower;
     doc["preEmphTime50"] = preEmphTime50;
+    doc["agcEnabled"] = agcEnabled;
+    doc["silenceThreshold"] = silenceThreshold;
+    doc["silenceHoldMs"] = silenceHoldMs;
+    doc["silenceRecoverMs"] = silenceRecoverMs;
+    doc["silenceMute"] = silenceMute;
+    doc["fallbackText"] = fallbackText;
+    unlockState();
     
     String response;
     serializeJson(doc, response);
@@ -277,17 +930,90 @@ void setupWebServer() {
     DynamicJsonDocument doc(1024);
     deserializeJson(doc, data, len);
     
-    frequency = doc["frequency"];
-    txFreqDeviation = doc["txFreqDeviation"];
-    rdsEnabled = doc["rdsEnabled"];
-    stationName = doc["stationName"].as<String>();
-    radioText = doc["radioText"].as<String>();
-    monoAudio = doc["monoAudio"];
-    txPower = doc["txPower"];
-    preEmphTime50 = doc["preEmphTime50"];
+    // 网页以字符串发送频率，按定点数解析
+    // 这里运行在async_tcp任务中，只解析，交给控制任务应用和保存
+    WebSettings ws = {};
+    long newFreq = parseFixed(doc["frequency"] | "", 2);
+    ws.freq10k = newFreq > 0 && channelInPlan(FM_CHANNEL_PLAN, newFreq) ? newFreq : 0;
+    ws.txFreqDeviation = doc["txFreqDeviation"];
+    ws.rdsEnabled = doc["rdsEnabled"];
+    strlcpy(ws.stationName, doc["stationName"] | "", sizeof(ws.stationName));
+    strlcpy(ws.radioText, doc["radioText"] | "", sizeof(ws.radioText));
+    ws.monoAudio = doc["monoAudio"];
+    ws.txPower = doc["txPower"];
+    ws.preEmphTime50 = doc["preEmphTime50"];
+    ws.agcEnabled = doc["agcEnabled"];
+    ws.silenceThreshold = doc["silenceThreshold"] | 1;
+    ws.silenceHoldMs = doc["silenceHoldMs"] | 5000;
+    ws.silenceRecoverMs = doc["silenceRecoverMs"] | 1000;
+    ws.silenceMute = doc["silenceMute"];
+    strlcpy(ws.fallbackText, doc["fallbackText"] | "", sizeof(ws.fallbackText));
+    if (xQueueSend(settingsQueue, &ws, 0) != pdTRUE) {
+      Serial.println("设置队列已满，本次设置被忽略");
+    }
+  });
+  
+  // API端点 - 静音和恢复事件
+  server.on("/api/events", HTTP_GET, [](AsyncWebServerRequest *request) {
+    AudioEvent events[EVENT_LOG_LEN];
+    uint8_t count = copyAudioEvents(events);
+    DynamicJsonDocument doc(4096);
+    doc["uptimeMs"] = millis();
+    doc["silent"] = audioSilent;
+    doc["total"] = eventCount;
+    JsonArray list = doc.createNestedArray("events");
+    for (uint8_t i = 0; i < count; i++) {
+      JsonObject e = list.createNestedObject();
+      e["timeMs"] = events[i].timeMs;
+      e["type"] = audioEventNames[events[i].type];
+      e["peak"] = events[i].peak;
+      e["durationMs"] = events[i].durationMs;
+    }
+    String response;
+    serializeJson(doc, response);
+    request->send(200, "application/json", response);
+  });
+  
+  // API端点 - I2C记录（二进制，格式见QN8027Trace.h）
+  server.on("/api/trace", HTTP_GET, [](AsyncWebServerRequest *request) {
+    uint8_t* image = NULL;
+    size_t len = copyTrace(&image);
+    if (len == 0) {
+      request->send(404, "text/plain", "No trace, start it with 'trace on'");
+      return;
+    }
+    AsyncResponseStream* response = request->beginResponseStream("application/octet-stream");
+    response->write(image, len);
+    free(image);
+    request->send(response);
+  });
+  
+  server.begin();
+}
+
+// Web提交的设置，在控制任务中应用
+void applyWebSettings() {
+  WebSettings ws;
+  while (xQueueReceive(settingsQueue, &ws, 0) == pdTRUE) {
+    lockState();
+    if (ws.freq10k != 0) freq10k = ws.freq10k;
+    txFreqDeviation = ws.txFreqDeviation;
+    rdsEnabled = ws.rdsEnabled;
+    stationName = ws.stationName;
+    radioText = ws.radioText;
+    monoAudio = ws.monoAudio;
+    txPower = ws.txPower;
+    preEmphTime50 = ws.preEmphTime50;
+    agcEnabled = ws.agcEnabled;
+    if (ws.silenceThreshold >= 1 && ws.silenceThreshold <= 15) silenceThreshold = ws.silenceThreshold;
+    if (ws.silenceHoldMs >= 1 && ws.silenceHoldMs <= SILENCE_MS_MAX) silenceHoldMs = ws.silenceHoldMs;
+    if (ws.silenceRecoverMs >= 1 && ws.silenceRecoverMs <= SILENCE_MS_MAX) silenceRecoverMs = ws.silenceRecoverMs;
+    silenceMute = ws.silenceMute;
+    if (ws.fallbackText[0] != '\0') fallbackText = ws.fallbackText;
     
     // 应用设置
-    radio.setFrequency(frequency);
+    radio.beginUpdate();
+    radio.setChannel(freq10k);
     radio.setTxFreqDeviation(txFreqDeviation);
     radio.setTxPower(txPower);
     
@@ -308,118 +1034,898 @@ void setupWebServer() {
     } else {
       radio.RDS(OFF);
     }
+    radio.endUpdate();
+    radio.setAGC(agcEnabled ? ON : OFF);
+    unlockState();
+    updateRDSContent();
     
     // 保存设置
     saveSettings();
     
     // 更新显示
-    updateDisplay();
-  });
+    requestDisplay(DISPLAY_REFRESH);
+  }
+}
+
+// 串口命令：字节到达时逐个拼成一行（固定缓冲区，不阻塞也不分配内存），
+// 整行收齐后在命令表中查找并调用处理函数，参数原地切分并按整数或定点数解析
+#define CMD_LINE_MAX 96
+char cmdLine[CMD_LINE_MAX];
+uint8_t cmdLen = 0;
+bool cmdOverflow = false;         // 本行超长，丢弃到行尾
+
+// 取下一个空格分隔的参数，原地加'\0'，没有参数时返回NULL
+char* nextArg(char** rest) {
+  char* p = *rest;
+  while (*p == ' ') p++;
+  if (*p == '\0') {
+    *rest = p;
+    return NULL;
+  }
+  char* arg = p;
+  while (*p != '\0' && *p != ' ') p++;
+  if (*p != '\0') *p++ = '\0';
+  *rest = p;
+  return arg;
+}
+
+// 定点数参数，结果乘以10^decimals，超出[minValue, maxValue]返回false
+bool argFixed(char** rest, uint8_t decimals, long minValue, long maxValue, long* value) {
+  char* arg = nextArg(rest);
+  if (arg == NULL) return false;
+  long v = parseFixed(arg, decimals);
+  if (v < 0 || v < minValue || v > maxValue) return false;
+  *value = v;
+  return true;
+}
+
+bool argInt(char** rest, long minValue, long maxValue, long* value) {
+  return argFixed(rest, 0, minValue, maxValue, value);
+}
+
+// "on"/"off"，返回ON/OFF，其他返回-1
+int8_t argOnOff(char** rest) {
+  char* arg = nextArg(rest);
+  if (arg == NULL) return -1;
+  if (strcmp(arg, "on") == 0) return ON;
+  if (strcmp(arg, "off") == 0) return OFF;
+  return -1;
+}
+
+// 行尾剩余的文本（去掉前导空格），为空返回NULL
+char* argText(char* rest) {
+  while (*rest == ' ') rest++;
+  return *rest != '\0' ? rest : NULL;
+}
+
+// 参数表：串口命令和二进制协议共用。数值参数用芯片/设置本身的单位（频率10kHz，频偏寄存器值等）
+// PARAM_AUTO_OFF只读：静音由固件检测和切换，芯片的无音频自动关闭在setup()里固定关闭
+enum ParamId : uint8_t {
+  PARAM_FREQ = 1, PARAM_POWER, PARAM_DEVIATION, PARAM_PILOT, PARAM_RDS_DEVIATION,
+  PARAM_RDS, PARAM_RDS_MIX, PARAM_MONO, PARAM_PREEMPH_50, PARAM_MUTE,
+  PARAM_SCRAMBLE, PARAM_RADIO, PARAM_AUTO_OFF, PARAM_INPUT_GAIN, PARAM_DIGITAL_GAIN,
+  PARAM_IMPEDANCE, PARAM_CRYSTAL, PARAM_CLOCK, PARAM_CRYSTAL_CURRENT, PARAM_AGC,
+  PARAM_SILENCE_THRESHOLD, PARAM_SILENCE_HOLD, PARAM_SILENCE_RECOVER, PARAM_SILENCE_MUTE,
+  PARAM_RDS_PREDICTION, PARAM_PEAK_CLEAR_POLICY,
+  PARAM_STATION_NAME = 32, PARAM_RADIO_TEXT, PARAM_FALLBACK_TEXT
+};
+
+bool isTextParam(uint8_t id) {
+  return id >= PARAM_STATION_NAME && id <= PARAM_FALLBACK_TEXT;
+}
+
+// 检查范围并应用到芯片和设置，不保存（调用者决定何时saveParam）
+bool setParam(uint8_t id, long value) {
+  bool rdsChanged = false;
+  lockState();
+  switch (id) {
+    case PARAM_FREQ:
+      if (value < 0 || value > 0xFFFF || !channelInPlan(FM_CHANNEL_PLAN, value)) goto invalid;
+      freq10k = value;
+      radio.setChannel(freq10k);
+      break;
+    case PARAM_POWER:
+      if (value < 0 || value > 100) goto invalid;
+      txPower = value;
+      radio.setTxPower(txPower);
+      break;
+    case PARAM_DEVIATION:
+      if (value < 0 || value > 255) goto invalid;
+      txFreqDeviation = value;
+      radio.setTxFreqDeviation(txFreqDeviation);
+      break;
+    case PARAM_PILOT:
+      if (value < 7 || value > 10) goto invalid;
+      radio.setTxPilotFreqDeviation(value);
+      break;
+    case PARAM_RDS_DEVIATION:
+      if (value < 0 || value > 127) goto invalid;
+      radio.setRDSFreqDeviation(value);
+      break;
+    case PARAM_RDS:
+      if (value != ON && value != OFF) goto invalid;
+      rdsEnabled = value == ON;
+      radio.RDS(value);
+      rdsChanged = true;
+      break;
+    case PARAM_RDS_MIX:
+      if (value < 0 || value > 11) goto invalid;
+      rdsMix = value;
+      radio.setRDSMix(rdsMix);
+      break;
+    case PARAM_MONO:
+      if (value != ON && value != OFF) goto invalid;
+      monoAudio = value == ON;
+      radio.MonoAudio(value);
+      break;
+    case PARAM_PREEMPH_50:
+      if (value != ON && value != OFF) goto invalid;
+      preEmphTime50 = value == ON;
+      radio.setPreEmphTime50(value);
+      break;
+    case PARAM_MUTE:
+      if (value != ON && value != OFF) goto invalid;
+      radio.mute(value);
+      silenceMuted = false;       // 手动控制后静音恢复时不再自动取消
+      break;
+    case PARAM_SCRAMBLE:
+      if (value != ON && value != OFF) goto invalid;
+      radio.scrambleAudio(value);
+      break;
+    case PARAM_RADIO:
+      if (value != ON && value != OFF) goto invalid;
+      radio.Switch(value);
+      break;
+    case PARAM_INPUT_GAIN:
+      if (value < 0 || value > 5) goto invalid;
+      radio.setTxInputBufferGain(value);
+      break;
+    case PARAM_DIGITAL_GAIN:
+      if (value < 0 || value > 2) goto invalid;
+      radio.setTxDigitalGain(value);
+      break;
+    case PARAM_IMPEDANCE:
+      if (value != 5 && value != 10 && value != 20 && value != 40) goto invalid;
+      radio.setAudioInpImp(value);
+      break;
+    case PARAM_CRYSTAL:
+      if (value != 12 && value != 24) goto invalid;
+      radio.setCrystalFreq(value);
+      break;
+    case PARAM_CLOCK:
+      if (value < 0 || value > 3) goto invalid;
+      radio.setClockSource(value);
+      break;
+    case PARAM_CRYSTAL_CURRENT:     // 最大值的0.1%
+      if (value < 0 || value > 1000) goto invalid;
+      radio.setCrystalCurrent(value / 10.0f);
+      break;
+    case PARAM_AGC:
+      if (value != ON && value != OFF) goto invalid;
+      agcEnabled = value == ON;
+      radio.setAGC(value);
+      break;
+    case PARAM_SILENCE_THRESHOLD:
+      if (value < 1 || value > 15) goto invalid;
+      silenceThreshold = value;
+      break;
+    case PARAM_SILENCE_HOLD:
+      if (value < 1 || value > SILENCE_MS_MAX) goto invalid;
+      silenceHoldMs = value;
+      break;
+    case PARAM_SILENCE_RECOVER:
+      if (value < 1 || value > SILENCE_MS_MAX) goto invalid;
+      silenceRecoverMs = value;
+      break;
+    case PARAM_SILENCE_MUTE:
+      if (value != ON && value != OFF) goto invalid;
+      silenceMute = value == ON;
+      break;
+    case PARAM_RDS_PREDICTION:
+      if (value != ON && value != OFF) goto invalid;
+      radio.setRDSPrediction(value);
+      break;
+    case PARAM_PEAK_CLEAR_POLICY:
+      if (value != PEAK_CLEAR_MANUAL && value != PEAK_CLEAR_ON_POLL) goto invalid;
+      radio.setPeakClearPolicy(value);
+      break;
+    default:
+      goto invalid;
+  }
+  unlockState();
+  if (rdsChanged) updateRDSContent();
+  return true;
   
-  server.begin();
+invalid:
+  unlockState();
+  return false;
 }
 
-void handleSerialCommands() {
-  if (Serial.available()) {
-    String command = Serial.readStringUntil('\n');
-    command.trim();
-    
-    // 解析命令
-    if (command.startsWith("freq ")) {
-      float newFreq = command.substring(5).toFloat();
-      if (newFreq >= 76.0 && newFreq <= 108.0) {
-        frequency = newFreq;
-        radio.setFrequency(frequency);
-        Serial.println("频率已设置为: " + String(frequency) + " MHz");
-        saveSettings();
-      } else {
-        Serial.println("频率必须在76-108 MHz范围内");
-      }
-    }
-    else if (command.startsWith("power ")) {
-      int newPower = command.substring(6).toInt();
-      if (newPower >= 0 && newPower <= 100) {
-        txPower = newPower;
-        radio.setTxPower(txPower);
-        Serial.println("发射功率已设置为: " + String(txPower) + "%");
-        saveSettings();
-      } else {
-        Serial.println("功率必须在0-100%范围内");
-      }
-    }
-    else if (command.startsWith("name ")) {
-      stationName = command.substring(5);
+bool getParam(uint8_t id, long* value) {
+  lockState();
+  switch (id) {
+    case PARAM_FREQ:              *value = freq10k; break;
+    case PARAM_POWER:             *value = txPower; break;
+    case PARAM_DEVIATION:         *value = txFreqDeviation; break;
+    case PARAM_PILOT:             *value = radio.TxPilotFreqDeviation; break;
+    case PARAM_RDS_DEVIATION:     *value = radio.RDSFreqDeviationKHz; break;
+    case PARAM_RDS:               *value = rdsEnabled; break;
+    case PARAM_RDS_MIX:           *value = rdsMix; break;
+    case PARAM_MONO:              *value = monoAudio; break;
+    case PARAM_PREEMPH_50:        *value = preEmphTime50; break;
+    case PARAM_MUTE:              *value = radio.muteAudio != 0; break;
+    case PARAM_SCRAMBLE:          *value = radio.privateMode != 0; break;
+    case PARAM_RADIO:             *value = radio.radioStatus != 0; break;
+    case PARAM_AUTO_OFF:          *value = radio.PAAutoOffTime != 48; break;
+    case PARAM_INPUT_GAIN:        *value = radio.TxInputBufferGain >> 4; break;
+    case PARAM_DIGITAL_GAIN:      *value = radio.TxDigitalGain >> 2; break;
+    case PARAM_IMPEDANCE:         *value = 5 << radio.LRInputImpdKOhm; break;
+    case PARAM_CRYSTAL:           *value = radio.crystalFreqMHz ? 24 : 12; break;
+    case PARAM_CLOCK:             *value = radio.clockSource >> 6; break;
+    case PARAM_CRYSTAL_CURRENT:   *value = radio.CrystalCurrentuA * 1000L / 64; break;
+    case PARAM_AGC:               *value = agcEnabled; break;
+    case PARAM_SILENCE_THRESHOLD: *value = silenceThreshold; break;
+    case PARAM_SILENCE_HOLD:      *value = silenceHoldMs; break;
+    case PARAM_SILENCE_RECOVER:   *value = silenceRecoverMs; break;
+    case PARAM_SILENCE_MUTE:      *value = silenceMute; break;
+    case PARAM_RDS_PREDICTION:    *value = radio.rdsPrediction; break;
+    case PARAM_PEAK_CLEAR_POLICY: *value = radio.peakClearPolicy; break;
+    default:
+      unlockState();
+      return false;
+  }
+  unlockState();
+  return true;
+}
+
+bool setTextParam(uint8_t id, const char* text) {
+  lockState();
+  switch (id) {
+    case PARAM_STATION_NAME:
+      stationName = text;
       if (stationName.length() > 8) stationName = stationName.substring(0, 8);
-      Serial.println("电台名称已设置为: " + stationName);
-      saveSettings();
-    }
-    else if (command.startsWith("text ")) {
-      radioText = command.substring(5);
-      Serial.println("电台文本已设置为: " + radioText);
-      saveSettings();
-    }
-    else if (command == "rds on") {
-      rdsEnabled = true;
-      radio.RDS(ON);
-      Serial.println("RDS已启用");
-      saveSettings();
-    }
-    else if (command == "rds off") {
-      rdsEnabled = false;
-      radio.RDS(OFF);
-      Serial.println("RDS已禁用");
+      break;
+    case PARAM_RADIO_TEXT:
+      radioText = text;
+      break;
+    case PARAM_FALLBACK_TEXT:
+      fallbackText = text;
+      break;
+    default:
+      unlockState();
+      return false;
+  }
+  unlockState();
+  updateRDSContent();
+  return true;
+}
+
+// 文本参数本身，调用者读取时持有stateMutex
+String* textParam(uint8_t id) {
+  switch (id) {
+    case PARAM_STATION_NAME:  return &stationName;
+    case PARAM_RADIO_TEXT:    return &radioText;
+    case PARAM_FALLBACK_TEXT: return &fallbackText;
+    default:                  return NULL;
+  }
+}
+
+// 设置项写入NVS；只在芯片寄存器里的参数保存寄存器镜像，快速启动时恢复；静音和开关发射不保存
+void saveParam(uint8_t id) {
+  switch (id) {
+    case PARAM_MUTE:
+    case PARAM_RADIO:
+    case PARAM_RDS_MIX:
+    case PARAM_RDS_PREDICTION:
+    case PARAM_PEAK_CLEAR_POLICY:
+      break;
+    case PARAM_PILOT:
+    case PARAM_RDS_DEVIATION:
+    case PARAM_SCRAMBLE:
+    case PARAM_INPUT_GAIN:
+    case PARAM_DIGITAL_GAIN:
+    case PARAM_IMPEDANCE:
+    case PARAM_CRYSTAL:
+    case PARAM_CLOCK:
+    case PARAM_CRYSTAL_CURRENT:
+      saveRegImage();
+      break;
+    default:
       saveSettings();
+      break;
+  }
+}
+
+// 处理函数参数格式错误时返回false，由调用者打印用法
+bool cmdFreq(char* args) {
+  long newFreq;
+  char freqText[8];
+  if (argFixed(&args, 2, FM_CHANNEL_PLAN.min10kHz, FM_CHANNEL_PLAN.max10kHz, &newFreq) &&
+      setParam(PARAM_FREQ, newFreq)) {
+    Serial.println("频率已设置为: " + String(formatFreq(freq10k, freqText)) + " MHz");
+    saveParam(PARAM_FREQ);
+  } else {
+    Serial.print("频率必须在");
+    Serial.print(formatFreq(FM_CHANNEL_PLAN.min10kHz, freqText));
+    Serial.print("-");
+    Serial.print(formatFreq(FM_CHANNEL_PLAN.max10kHz, freqText));
+    Serial.print(" MHz范围内，步进");
+    Serial.print(FM_CHANNEL_PLAN.step10kHz * 10);
+    Serial.println("kHz");
+  }
+  return true;
+}
+
+// 整数参数命令的公共部分，范围由setParam检查
+bool intCommand(char* args, uint8_t id, const char* label, const char* unit) {
+  long value;
+  if (!argInt(&args, 0, 3600000L, &value) || !setParam(id, value)) return false;
+  Serial.print(label);
+  Serial.print(value);
+  Serial.println(unit);
+  saveParam(id);
+  return true;
+}
+
+bool onOffCommand(char* args, uint8_t id, const char* onText, const char* offText) {
+  int8_t onOff = argOnOff(&args);
+  if (onOff < 0 || !setParam(id, onOff)) return false;
+  Serial.println(onOff == ON ? onText : offText);
+  saveParam(id);
+  return true;
+}
+
+bool textCommand(char* args, uint8_t id, const char* label) {
+  char* text = argText(args);
+  if (text == NULL || !setTextParam(id, text)) return false;
+  lockState();
+  Serial.println(label + *textParam(id));
+  unlockState();
+  saveParam(id);
+  return true;
+}
+
+bool cmdPower(char* args)       { return intCommand(args, PARAM_POWER, "发射功率已设置为: ", "%"); }
+bool cmdPilot(char* args)       { return intCommand(args, PARAM_PILOT, "导频频偏已设置为: ", "%"); }
+bool cmdRDSMix(char* args)      { return intCommand(args, PARAM_RDS_MIX, "电台名称每秒发送组数: ", ""); }
+bool cmdDigitalGain(char* args) { return intCommand(args, PARAM_DIGITAL_GAIN, "数字增益已设置为: ", " dB"); }
+bool cmdImpedance(char* args)   { return intCommand(args, PARAM_IMPEDANCE, "输入阻抗已设置为: ", " kOhm"); }
+bool cmdCrystal(char* args)     { return intCommand(args, PARAM_CRYSTAL, "晶振频率已设置为: ", " MHz"); }
+bool cmdClockSource(char* args) { return intCommand(args, PARAM_CLOCK, "时钟源已设置为: ", ""); }
+
+bool cmdInputGain(char* args) {
+  return intCommand(args, PARAM_INPUT_GAIN, "输入增益已设置为: ", agcEnabled ? " (自动音量控制会继续调整)" : "");
+}
+
+bool cmdRDS(char* args)      { return onOffCommand(args, PARAM_RDS, "RDS已启用", "RDS已禁用"); }
+bool cmdMono(char* args)     { return onOffCommand(args, PARAM_MONO, "单声道模式已启用", "单声道模式已禁用"); }
+bool cmdMute(char* args)     { return onOffCommand(args, PARAM_MUTE, "音频已静音", "音频已取消静音"); }
+bool cmdScramble(char* args) { return onOffCommand(args, PARAM_SCRAMBLE, "音频加扰已启用", "音频加扰已禁用"); }
+bool cmdRadio(char* args)    { return onOffCommand(args, PARAM_RADIO, "发射已开启", "发射已关闭"); }
+bool cmdAGC(char* args)      { return onOffCommand(args, PARAM_AGC, "自动音量控制已启用", "自动音量控制已禁用"); }
+bool cmdRDSPredict(char* args) { return onOffCommand(args, PARAM_RDS_PREDICTION, "RDS预测轮询已启用", "RDS预测轮询已禁用"); }
+
+// 1 == 每次采样后清除峰值（静音检测和音量表需要），0 == 只由peakclear清除
+bool cmdPeakPolicy(char* args) {
+  long policy;
+  if (!argInt(&args, PEAK_CLEAR_MANUAL, PEAK_CLEAR_ON_POLL, &policy) || !setParam(PARAM_PEAK_CLEAR_POLICY, policy)) return false;
+  Serial.println(policy == PEAK_CLEAR_ON_POLL ? "峰值每次采样后清除" : "峰值只由peakclear清除，静音检测和音量表看到的是保持的峰值");
+  return true;
+}
+
+bool cmdName(char* args)     { return textCommand(args, PARAM_STATION_NAME, "电台名称已设置为: "); }
+bool cmdText(char* args)     { return textCommand(args, PARAM_RADIO_TEXT, "电台文本已设置为: "); }
+bool cmdFallback(char* args) { return textCommand(args, PARAM_FALLBACK_TEXT, "备用文本已设置为: "); }
+
+// 频偏以kHz输入，芯片步进0.58kHz（58个10Hz单位）
+bool cmdDeviation(char* args) {
+  long dev10Hz;
+  if (!argFixed(&args, 2, 0, 255L * 58, &dev10Hz) || !setParam(PARAM_DEVIATION, (dev10Hz + 29) / 58)) return false;
+  Serial.println("频偏已设置为: " + String(txFreqDeviation) + " (" + String(txFreqDeviation * 58 / 100) + " kHz)");
+  saveParam(PARAM_DEVIATION);
+  return true;
+}
+
+// RDS频偏以kHz输入，芯片步进0.35kHz
+bool cmdRDSDeviation(char* args) {
+  long dev10Hz;
+  if (!argFixed(&args, 2, 0, 127L * 35, &dev10Hz)) return false;
+  uint8_t n = (dev10Hz + 17) / 35;
+  if (!setParam(PARAM_RDS_DEVIATION, n)) return false;
+  Serial.println("RDS频偏已设置为: " + String(n) + " (" + String(n * 35 / 100) + "." + String(n * 35 % 100 / 10) + " kHz)");
+  saveParam(PARAM_RDS_DEVIATION);
+  return true;
+}
+
+bool cmdPreEmph(char* args) {
+  long us;
+  if (!argInt(&args, 50, 75, &us) || (us != 50 && us != 75)) return false;
+  setParam(PARAM_PREEMPH_50, us == 50 ? ON : OFF);
+  Serial.println("预加重已设置为: " + String(us) + " us");
+  saveParam(PARAM_PREEMPH_50);
+  return true;
+}
+
+// 晶振电流以最大值(400uA)的百分比输入，可带一位小数
+bool cmdCrystalCurrent(char* args) {
+  long percent10;
+  if (!argFixed(&args, 1, 0, 1000, &percent10) || !setParam(PARAM_CRYSTAL_CURRENT, percent10)) return false;
+  Serial.println("晶振电流已设置为: " + String(percent10 * 4 / 10) + " uA");
+  saveParam(PARAM_CRYSTAL_CURRENT);
+  return true;
+}
+
+// silence <阈值1-15> <判定毫秒> [恢复毫秒]  或  silence mute on/off
+bool cmdSilence(char* args) {
+  char* rest = args;
+  char* first = nextArg(&rest);
+  if (first != NULL && strcmp(first, "mute") == 0) {
+    return onOffCommand(rest, PARAM_SILENCE_MUTE, "静音时关闭音频输出", "静音时保持音频输出");
+  }
+  
+  long threshold, holdMs, recoverMs = silenceRecoverMs;
+  rest = args;
+  if (!argInt(&rest, 1, 15, &threshold) || !argInt(&rest, 1, SILENCE_MS_MAX, &holdMs)) return false;
+  if (argText(rest) != NULL && !argInt(&rest, 1, SILENCE_MS_MAX, &recoverMs)) return false;
+  setParam(PARAM_SILENCE_THRESHOLD, threshold);
+  setParam(PARAM_SILENCE_HOLD, holdMs);
+  setParam(PARAM_SILENCE_RECOVER, recoverMs);
+  Serial.println("静音检测: 峰值 < " + String(silenceThreshold) + " 持续 " + String(silenceHoldMs) +
+                 " ms, 恢复 " + String(silenceRecoverMs) + " ms");
+  saveSettings();
+  return true;
+}
+
+bool cmdPeakClear(char* args) {
+  lockState();
+  radio.clearAudioPeak();
+  unlockState();
+  Serial.println("音频峰值已清除");
+  return true;
+}
+
+bool cmdEvents(char* args) {
+  printAudioEvents();
+  return true;
+}
+
+bool cmdStatus(char* args) {
+  // 一次I2C传输读取信道和STATUS寄存器
+  uint16_t channel = 0;
+  lockState();
+  uint8_t chipStatus = radio.readStatus(&channel);
+  unlockState();
+  char freqText[8];
+  Serial.println("FM发射机状态:");
+  Serial.println("频率: " + String(formatFreq(freq10k, freqText)) + " MHz");
+  Serial.println("芯片频率: " + String(formatFreq(channel, freqText)) + " MHz");
+  Serial.println("换频延迟: " + String(radio.retuneLatencyUs) + " us" + (radio.retuneDeadAir ? " (曾中断发射)" : ""));
+  Serial.println("功率: " + String(txPower) + "%");
+  Serial.println("电台名称: " + stationName);
+  Serial.println("电台文本: " + radioText);
+  Serial.println("RDS: " + String(rdsEnabled ? "启用" : "禁用"));
+  Serial.println("RDS组: 已发送 " + String(radio.rdsGroupsSent) + ", 超时 " + String(radio.rdsTimeouts) +
+                 ", 重发 " + String(radio.rdsRetries) + ", 丢弃 " + String(radio.rdsDropped));
+  Serial.println("RDS队列: 深度 " + String(radio.rdsQueueDepth()) + ", 峰值 " + String(radio.rdsQueuePeak) +
+                 ", 溢出 " + String(radio.rdsQueueOverflows) + ", 迟到 " + String(radio.rdsLateGroups));
+  Serial.println("RDS轮询: 上一组 " + String(radio.rdsLastGroupPolls) + " 次, 最多 " + String(radio.rdsMaxGroupPolls) +
+                 " 次, 总计 " + String(radio.rdsGroupPolls) + " 次, 预测失误 " + String(radio.rdsPredictMisses) +
+                 ", 周期 " + String(radio.rdsGroupPeriodUs()) + " us");
+  Serial.println("单声道: " + String(monoAudio ? "启用" : "禁用"));
+  Serial.println("静音检测: " + String(audioSilent ? "静音中" : "正常") + ", 峰值 < " + String(silenceThreshold) +
+                 " 持续 " + String(silenceHoldMs) + " ms" + (silenceMute ? ", 静音时关闭输出" : "") +
+                 ", 事件 " + String(eventCount) + " 个");
+  Serial.println("自动音量: " + String(agcEnabled ? "启用" : "禁用") + ", 输入增益 " + String(radio.TxInputBufferGain >> 4) +
+                 ", 频偏 " + String(radio.TxFreqDeviation) + ", 调整 " + String(radio.agcAdjustments) +
+                 " 次, 超限 " + String(radio.agcOverLimitMs) + " ms");
+  Serial.println("I2C错误: " + String(radio.i2cErrors) + " 次, 重试 " + String(radio.i2cRetries) + " 次, 放弃 " +
+                 String(radio.i2cFailures) + " 次, 总线恢复 " + String(radio.busRecoveries) + " 次, 上次结果 " +
+                 String(radio.lastError) + (radio.writesPending() ? ", 有设置等待重写" : ""));
+  Serial.println("OLED: " + String(oledBytesPerSec) + " 字节/秒, 总计 " + String(oledBytesFlushed) + " 字节");
+  if (wifiState == WIFI_STA_CONNECTED) {
+    Serial.println("WiFi: 已连接 " + WiFi.localIP().toString() + ", 重连 " + String(wifiReconnects) + " 次");
+  } else {
+    Serial.println("WiFi: 连接中, 退避 " + String(wifiBackoffMs) + " ms" + (apActive ? String(", 热点 ") + WiFi.softAPIP().toString() : String()));
+  }
+  Serial.println("状态: " + stats[chipStatus & 7]);
+  return true;
+}
+
+bool cmdBoot(char* args) {
+  printBootTimes();
+  return true;
+}
+
+bool cmdTasks(char* args) {
+  printTaskStats();
+  return true;
+}
+
+bool cmdBus(char* args) {
+  printBusStats();
+  return true;
+}
+
+bool cmdReset(char* args) {
+  lockState();
+  radio.reset();
+  radio.reCalibrate();
+  unlockState();
+  Serial.println("FM发射机已重置");
+  return true;
+}
+
+// trace on [KB] | off | clear | dump，无参数时显示记录状态
+bool cmdTrace(char* args) {
+  char* rest = args;
+  char* sub = nextArg(&rest);
+  if (sub == NULL) {
+    Serial.println("I2C记录: " + String(i2cTrace.recording() ? "记录中" : "已停止") + ", 缓冲区 " +
+                   String((unsigned long)i2cTrace.capacity() / 1024) + " KB, " + String(i2cTrace.records) + " 条, 共记录 " +
+                   String(i2cTrace.recorded) + " 条, 覆盖 " + String(i2cTrace.dropped) + " 条");
+    return true;
+  }
+  if (strcmp(sub, "on") == 0) {
+    long kb = TRACE_DEFAULT_KB;
+    if (argText(rest) != NULL && !argInt(&rest, 1, TRACE_MAX_KB, &kb)) return false;
+    if (i2cTrace.capacity() == (size_t)kb * 1024) {
+      i2cTrace.start();
+    } else if (!i2cTrace.begin(kb * 1024)) {
+      Serial.println("内存不足，无法分配 " + String(kb) + " KB");
+      return true;
     }
-    else if (command == "mono on") {
-      monoAudio = true;
-      radio.MonoAudio(ON);
-      Serial.println("单声道模式已启用");
-      saveSettings();
+    lockState();
+    radio.setTrace(&i2cTrace);
+    unlockState();
+    Serial.println("I2C记录已开始, 缓冲区 " + String(kb) + " KB");
+  } else if (strcmp(sub, "off") == 0) {
+    i2cTrace.stop();
+    Serial.println("I2C记录已停止, " + String(i2cTrace.records) + " 条");
+  } else if (strcmp(sub, "clear") == 0) {
+    i2cTrace.clear();
+    Serial.println("I2C记录已清空");
+  } else if (strcmp(sub, "dump") == 0) {
+    printTrace();
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool cmdHelp(char* args);
+
+struct SerialCommand {
+  const char* name;
+  bool (*handler)(char* args);
+  const char* usage;              // 参数格式，格式错误时打印
+  const char* help;
+};
+
+const SerialCommand serialCommands[] = {
+  {"freq",     cmdFreq,           "<76-108>",                  "设置发射频率 (MHz)"},
+  {"power",    cmdPower,          "<0-100>",                   "设置发射功率 (%)"},
+  {"dev",      cmdDeviation,      "<0-147.9>",                 "设置频偏 (kHz)"},
+  {"pilot",    cmdPilot,          "<7-10>",                    "设置导频频偏 (%)"},
+  {"name",     cmdName,           "<文本>",                    "设置电台名称 (最多8字符)"},
+  {"text",     cmdText,           "<文本>",                    "设置RDS文本"},
+  {"rds",      cmdRDS,            "on/off",                    "启用/禁用RDS"},
+  {"rdsdev",   cmdRDSDeviation,   "<0-44.45>",                 "设置RDS频偏 (kHz)"},
+  {"rdsmix",   cmdRDSMix,         "<0-11>",                    "电台名称每秒发送组数"},
+  {"mono",     cmdMono,           "on/off",                    "启用/禁用单声道"},
+  {"preemph",  cmdPreEmph,        "50/75",                     "设置预加重时间 (us)"},
+  {"mute",     cmdMute,           "on/off",                    "静音/取消静音"},
+  {"scramble", cmdScramble,       "on/off",                    "启用/禁用音频加扰"},
+  {"radio",    cmdRadio,          "on/off",                    "开启/关闭发射"},
+  {"ibgain",   cmdInputGain,      "<0-5>",                     "设置输入缓冲增益"},
+  {"dgain",    cmdDigitalGain,    "<0-2>",                     "设置数字增益 (dB)"},
+  {"imp",      cmdImpedance,      "5/10/20/40",                "设置输入阻抗 (kOhm)"},
+  {"xtal",     cmdCrystal,        "12/24",                     "设置晶振频率 (MHz)"},
+  {"clock",    cmdClockSource,    "<0-3>",                     "设置时钟源"},
+  {"xcur",     cmdCrystalCurrent, "<0-100>",                   "设置晶振电流 (最大值的%)"},
+  {"agc",      cmdAGC,            "on/off",                    "启用/禁用自动音量控制"},
+  {"silence",  cmdSilence,        "<阈值> <毫秒> [恢复毫秒] | mute on/off", "设置静音检测"},
+  {"fallback", cmdFallback,       "<文本>",                    "设置静音时的RDS文本"},
+  {"peakclear", cmdPeakClear,     "",                          "清除音频峰值"},
+  {"peakpolicy", cmdPeakPolicy,   "0/1",                       "峰值清除方式 (1=每次采样后, 0=手动)"},
+  {"rdspredict", cmdRDSPredict,   "on/off",                    "RDS按预测时刻读取状态"},
+  {"events",   cmdEvents,         "",                          "显示静音和恢复事件"},
+  {"status",   cmdStatus,         "",                          "显示当前状态"},
+  {"boot",     cmdBoot,           "",                          "显示启动各阶段时间"},
+  {"tasks",    cmdTasks,          "",                          "显示各任务唤醒延迟"},
+  {"bus",      cmdBus,            "",                          "显示I2C总线等待时间"},
+  {"trace",    cmdTrace,          "on [1-64 KB] | off | clear | dump", "记录QN8027的I2C传输"},
+  {"reset",    cmdReset,          "",                          "重置FM发射机"},
+  {"help",     cmdHelp,           "",                          "显示此帮助"},
+};
+const uint8_t SERIAL_COMMAND_COUNT = sizeof(serialCommands) / sizeof(serialCommands[0]);
+
+bool cmdHelp(char* args) {
+  Serial.println("可用命令:");
+  for (uint8_t i = 0; i < SERIAL_COMMAND_COUNT; i++) {
+    const SerialCommand& c = serialCommands[i];
+    Serial.print(c.name);
+    if (c.usage[0] != '\0') {
+      Serial.print(" ");
+      Serial.print(c.usage);
     }
-    else if (command == "mono off") {
-      monoAudio = false;
-      radio.MonoAudio(OFF);
-      Serial.println("单声道模式已禁用");
-      saveSettings();
+    Serial.print(" - ");
+    Serial.println(c.help);
+  }
+  return true;
+}
+
+void runCommand(char* line) {
+  char* rest = line;
+  char* name = nextArg(&rest);
+  if (name == NULL) return;
+  
+  for (uint8_t i = 0; i < SERIAL_COMMAND_COUNT; i++) {
+    const SerialCommand& c = serialCommands[i];
+    if (strcmp(name, c.name) != 0) continue;
+    if (!c.handler(rest)) {
+      Serial.print("用法: ");
+      Serial.print(c.name);
+      Serial.print(" ");
+      Serial.println(c.usage);
     }
-    else if (command == "status") {
-      Serial.println("FM发射机状态:");
-      Serial.println("频率: " + String(frequency) + " MHz");
-      Serial.println("功率: " + String(txPower) + "%");
-      Serial.println("电台名称: " + stationName);
-      Serial.println("电台文本: " + radioText);
-      Serial.println("RDS: " + String(rdsEnabled ? "启用" : "禁用"));
-      Serial.println("单声道: " + String(monoAudio ? "启用" : "禁用"));
-      Serial.println("状态: " + stats[radio.getFSMStatus()]);
+    requestDisplay(DISPLAY_REFRESH);
+    return;
+  }
+  Serial.println("未知命令。使用'help'查看可用命令。");
+}
+
+// 二进制控制协议（自动化测试用），和文本命令共用同一个串口：
+// 在行首收到0x00就进入二进制模式，之后每个0x00结束一帧（COBS编码，CRC16校验，见BinaryFrame），
+// BIN_IDLE_MS内没有收到字节回到文本模式。
+// 请求: 命令, 序号, 参数...   应答: 命令|BIN_REPLY, 序号, 状态, 数据...   遥测: BIN_TELEMETRY, 序号, 数据
+// 多字节数值都是小端。损坏的帧不应答，由主机超时重发
+#define BIN_IDLE_MS 1000
+enum BinCommand : uint8_t {
+  BIN_PING = 0x01,              // 数据原样返回
+  BIN_GET = 0x02,               // 参数号 -> 参数号, int32或文本
+  BIN_SET = 0x03,               // 参数号, int32或文本 -> 参数号
+  BIN_REG_READ = 0x04,          // 起始寄存器, 个数 -> 寄存器值
+  BIN_REG_WRITE = 0x05,         // 起始寄存器, 值... （调试用，绕过设置项）
+  BIN_RDS_GROUP = 0x06,         // 8字节RDS组放入发送队列
+  BIN_SUBSCRIBE = 0x07,         // 遥测间隔ms(uint16)，0停止
+  BIN_SAVE = 0x08,              // 保存所有设置到NVS（SET本身不保存）
+  BIN_TELEMETRY = 0x40,
+  BIN_REPLY = 0x80
+};
+enum BinStatus : uint8_t {
+  BIN_OK, BIN_ERR_COMMAND, BIN_ERR_LENGTH, BIN_ERR_PARAM, BIN_ERR_VALUE, BIN_ERR_FULL,
+  BIN_ERR_BUS                   // 重试后芯片仍然没有应答
+};
+
+bool binMode = false;
+uint8_t binFrame[FRAME_ENCODED_MAX];
+uint8_t binLen = 0;
+bool binOverflow = false;
+unsigned long binLastByteMs = 0;
+uint32_t binFrames = 0;           // 正确收到的帧
+uint32_t binBadFrames = 0;        // CRC或COBS错误、超长的帧
+uint16_t telemetryIntervalMs = 0;
+unsigned long telemetryDueMs = 0;
+uint8_t telemetrySeq = 0;
+
+void putU16(uint8_t* p, uint16_t v) {
+  p[0] = v & 0xFF;
+  p[1] = v >> 8;
+}
+
+void putU32(uint8_t* p, uint32_t v) {
+  for (uint8_t i = 0; i < 4; i++) p[i] = v >> (8 * i);
+}
+
+uint32_t getU32(const uint8_t* p) {
+  return p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// 前后各加一个分隔符，前面的0x00把之前打印的文本和帧分开
+void sendFrame(const uint8_t* msg, uint8_t len) {
+  uint8_t encoded[FRAME_ENCODED_MAX + 2];
+  size_t n = frameEncode(msg, len, encoded + 1);
+  if (n == 0) return;
+  encoded[0] = FRAME_DELIMITER;
+  encoded[n + 1] = FRAME_DELIMITER;
+  Serial.write(encoded, n + 2);
+}
+
+void handleBinaryFrame() {
+  uint8_t msg[FRAME_MSG_MAX];
+  size_t n = frameDecode(binFrame, binLen, msg);
+  if (n < 2) {
+    binBadFrames++;
+    return;
+  }
+  binFrames++;
+  
+  const uint8_t* payload = msg + 2;
+  uint8_t payloadLen = n - 2;
+  uint8_t reply[FRAME_MSG_MAX];
+  uint8_t replyLen = 3;
+  reply[0] = msg[0] | BIN_REPLY;
+  reply[1] = msg[1];
+  uint8_t status = BIN_OK;
+  
+  switch (msg[0]) {
+    case BIN_PING:
+      if (payloadLen > FRAME_MSG_MAX - 3) payloadLen = FRAME_MSG_MAX - 3;
+      memcpy(reply + 3, payload, payloadLen);
+      replyLen += payloadLen;
+      break;
+      
+    case BIN_GET: {
+      if (payloadLen != 1) { status = BIN_ERR_LENGTH; break; }
+      reply[replyLen++] = payload[0];
+      long value;
+      if (isTextParam(payload[0])) {
+        lockState();
+        String* text = textParam(payload[0]);
+        uint8_t len = min((size_t)text->length(), (size_t)(FRAME_MSG_MAX - replyLen));
+        memcpy(reply + replyLen, text->c_str(), len);
+        unlockState();
+        replyLen += len;
+      } else if (getParam(payload[0], &value)) {
+        putU32(reply + replyLen, value);
+        replyLen += 4;
+      } else {
+        status = BIN_ERR_PARAM;
+      }
+      break;
     }
-    else if (command == "reset") {
-      radio.reset();
-      radio.reCalibrate();
-      Serial.println("FM发射机已重置");
+      
+    case BIN_SET:
+      if (payloadLen < 1) { status = BIN_ERR_LENGTH; break; }
+      reply[replyLen++] = payload[0];
+      if (isTextParam(payload[0])) {
+        char text[RDS_RT_CHARS + 1];
+        uint8_t len = min(payloadLen - 1, RDS_RT_CHARS);
+        memcpy(text, payload + 1, len);
+        text[len] = '\0';
+        if (!setTextParam(payload[0], text)) status = BIN_ERR_PARAM;
+      } else if (payloadLen != 5) {
+        status = BIN_ERR_LENGTH;
+      } else {
+        long value;
+        if (!getParam(payload[0], &value)) status = BIN_ERR_PARAM;
+        else if (!setParam(payload[0], (int32_t)getU32(payload + 1))) status = BIN_ERR_VALUE;
+      }
+      if (status == BIN_OK) requestDisplay(DISPLAY_REFRESH);
+      break;
+      
+    case BIN_REG_READ:
+      if (payloadLen != 2) { status = BIN_ERR_LENGTH; break; }
+      if (payload[0] + payload[1] > QN8027_REG_COUNT || payload[1] == 0) { status = BIN_ERR_VALUE; break; }
+      lockState();
+      if (radio.readBurst(payload[0], reply + replyLen, payload[1])) replyLen += payload[1];
+      else status = BIN_ERR_BUS;
+      unlockState();
+      break;
+      
+    case BIN_REG_WRITE: {
+      if (payloadLen < 2) { status = BIN_ERR_LENGTH; break; }
+      uint8_t count = payloadLen - 1;
+      if (payload[0] + count > QN8027_REG_COUNT) { status = BIN_ERR_VALUE; break; }
+      uint32_t regs = ((1UL << count) - 1) << payload[0];
+      if (regs & ~QN8027_WRITABLE_REGS) { status = BIN_ERR_VALUE; break; }
+      lockState();
+      if (!radio.writeRegs(payload[0], payload + 1, count)) status = BIN_ERR_BUS;
+      unlockState();
+      break;
     }
-    else if (command == "help") {
-      Serial.println("可用命令:");
-      Serial.println("freq <76-108> - 设置发射频率 (MHz)");
-      Serial.println("power <0-100> - 设置发射功率 (%)");
-      Serial.println("name <文本> - 设置电台名称 (最多8字符)");
-      Serial.println("text <文本> - 设置RDS文本");
-      Serial.println("rds on/off - 启用/禁用RDS");
-      Serial.println("mono on/off - 启用/禁用单声道");
-      Serial.println("status - 显示当前状态");
-      Serial.println("reset - 重置FM发射机");
-      Serial.println("help - 显示此帮助");
+      
+    case BIN_RDS_GROUP: {
+      if (payloadLen != 8) { status = BIN_ERR_LENGTH; break; }
+      lockState();
+      bool queued = radio.queueRDS(payload);
+      unlockState();
+      if (!queued) status = BIN_ERR_FULL;
+      else if (taskStats[TASK_RDS].handle) xTaskNotifyGive(taskStats[TASK_RDS].handle);
+      break;
     }
-    else {
-      Serial.println("未知命令。使用'help'查看可用命令。");
+      
+    case BIN_SUBSCRIBE:
+      if (payloadLen != 2) { status = BIN_ERR_LENGTH; break; }
+      telemetryIntervalMs = payload[0] | (payload[1] << 8);
+      if (telemetryIntervalMs != 0 && telemetryIntervalMs < CONTROL_INTERVAL_MS) telemetryIntervalMs = CONTROL_INTERVAL_MS;
+      telemetryDueMs = millis();
+      break;
+      
+    case BIN_SAVE:
+      saveSettings();
+      break;
+      
+    default:
+      status = BIN_ERR_COMMAND;
+      break;
+  }
+  
+  reply[2] = status;
+  sendFrame(reply, replyLen);
+}
+
+// 遥测帧: fsm, 峰值, 标志(bit0静音 bit1自动音量 bit2 WiFi已连接), 频率(10kHz,u16), 采样时间ms(u32),
+//         RDS已发送组数(u32), 输入增益, 频偏寄存器, 损坏帧数(u16)
+void serviceTelemetry() {
+  if (telemetryIntervalMs == 0 || (long)(millis() - telemetryDueMs) < 0) return;
+  telemetryDueMs += telemetryIntervalMs;
+  if ((long)(millis() - telemetryDueMs) >= 0) telemetryDueMs = millis() + telemetryIntervalMs;
+  
+  StatusSnapshot st = {0, 0, 0, 0, 0};
+  xQueuePeek(statusQueue, &st, 0);
+  uint8_t msg[19];
+  msg[0] = BIN_TELEMETRY;
+  msg[1] = telemetrySeq++;
+  msg[2] = st.fsm;
+  msg[3] = st.audioPeak;
+  msg[4] = (audioSilent ? 1 : 0) | (agcEnabled ? 2 : 0) | (wifiState == WIFI_STA_CONNECTED ? 4 : 0);
+  putU16(msg + 5, freq10k);
+  putU32(msg + 7, st.timeMs);
+  putU32(msg + 11, radio.rdsGroupsSent);
+  msg[15] = radio.TxInputBufferGain >> 4;
+  msg[16] = radio.TxFreqDeviation;
+  putU16(msg + 17, binBadFrames);
+  sendFrame(msg, sizeof(msg));
+}
+
+// 控制任务每次循环调用，只取已经到达的字节，不等待行尾
+void handleSerialCommands() {
+  while (Serial.available()) {
+    int c = Serial.read();
+    if (binMode) {
+      binLastByteMs = millis();
+      if (c == FRAME_DELIMITER) {
+        if (binOverflow) binBadFrames++;
+        else if (binLen > 0) handleBinaryFrame();
+        binLen = 0;
+        binOverflow = false;
+      } else if (binLen < sizeof(binFrame)) {
+        binFrame[binLen++] = c;
+      } else {
+        binOverflow = true;
+      }
+    } else if (c == FRAME_DELIMITER && cmdLen == 0) {
+      binMode = true;
+      binLen = 0;
+      binOverflow = false;
+      binLastByteMs = millis();
+    } else if (c == '\n' || c == '\r') {
+      if (cmdOverflow) {
+        Serial.println("命令过长，已忽略");
+      } else if (cmdLen > 0) {
+        cmdLine[cmdLen] = '\0';
+        runCommand(cmdLine);
+      }
+      cmdLen = 0;
+      cmdOverflow = false;
+    } else if (cmdLen < CMD_LINE_MAX - 1) {
+      cmdLine[cmdLen++] = c;
+    } else {
+      cmdOverflow = true;
     }
-    
-    updateDisplay();
+  }
+  
+  if (binMode && millis() - binLastByteMs > BIN_IDLE_MS) {
+    if (binLen > 0) binBadFrames++;
+    binMode = false;
   }
 }
 
 void loadSettings() {
   preferences.begin("fm_settings", false);
-  frequency = preferences.getFloat("frequency", 88.0);
+  if (!preferences.isKey("freq10k") && preferences.isKey("frequency")) {
+    // 旧版本以float MHz保存频率，升级后读一次换成10 kHz整数，保证升级后仍在原来的频率上发射
+    long oldFreq = lroundf(preferences.getFloat("frequency", 88.0f) * 100.0f);
+    if (oldFreq > 0 && oldFreq <= 0xFFFF && channelInPlan(FM_CHANNEL_PLAN, oldFreq)) {
+      preferences.putUShort("freq10k", oldFreq);
+    } else {
+      Serial.println("保存的频率 " + String(oldFreq) + " 无效，使用默认频率");
+    }
+    preferences.remove("frequency");
+  }
+  freq10k = preferences.getUShort("freq10k", 8800);
+  if (!channelInPlan(FM_CHANNEL_PLAN, freq10k)) freq10k = 8800;
   txFreqDeviation = preferences.getInt("txFreqDev", 150);
   rdsEnabled = preferences.getBool("rdsEnabled", true);
   stationName = preferences.getString("stationName", "QN8027FM");
@@ -427,12 +1933,18 @@ void loadSettings() {
   monoAudio = preferences.getBool("monoAudio", false);
   txPower = preferences.getInt("txPower", 75);
   preEmphTime50 = preferences.getBool("preEmphTime50", true);
+  agcEnabled = preferences.getBool("agc", false);
+  silenceThreshold = preferences.getUChar("silThresh", 1);
+  silenceHoldMs = preferences.getUInt("silHoldMs", 5000);
+  silenceRecoverMs = preferences.getUInt("silRecMs", 1000);
+  silenceMute = preferences.getBool("silMute", false);
+  fallbackText = preferences.getString("fallback", "Audio interrupted, please stay tuned");
   preferences.end();
 }
 
 void saveSettings() {
   preferences.begin("fm_settings", false);
-  preferences.putFloat("frequency", frequency);
+  preferences.putUShort("freq10k", freq10k);
   preferences.putInt("txFreqDev", txFreqDeviation);
   preferences.putBool("rdsEnabled", rdsEnabled);
   preferences.putString("stationName", stationName);
@@ -440,5 +1952,94 @@ void saveSettings() {
   preferences.putBool("monoAudio", monoAudio);
   preferences.putInt("txPower", txPower);
   preferences.putBool("preEmphTime50", preEmphTime50);
+  preferences.putBool("agc", agcEnabled);
+  preferences.putUChar("silThresh", silenceThreshold);
+  preferences.putUInt("silHoldMs", silenceHoldMs);
+  preferences.putUInt("silRecMs", silenceRecoverMs);
+  preferences.putBool("silMute", silenceMute);
+  preferences.putString("fallback", fallbackText);
   preferences.end();
-}
\ No newline at end of file
+  saveRegImage();
+}
+
+// 寄存器镜像（0x00-0x12）作为一个blob保存，启动时一次读取、一次写入芯片
+bool loadRegImage() {
+  uint8_t image[QN8027_REG_COUNT];
+  preferences.begin("fm_settings", true);
+  bool found = preferences.getBytesLength("regImage") == sizeof(image) &&
+               preferences.getBytes("regImage", image, sizeof(image)) == sizeof(image);
+  preferences.end();
+  return found && radio.loadRegImage(image);
+}
+
+void saveRegImage() {
+  uint8_t image[QN8027_REG_COUNT];
+  lockState();
+  radio.getRegImage(image);
+  unlockState();
+  preferences.begin("fm_settings", false);
+  preferences.putBytes("regImage", image, sizeof(image));
+  preferences.end();
+}
+
+void markBoot(BootPhase phase) {
+  bootUs[phase] = micros();
+}
+
+void printBootTimes() {
+  Serial.println(fastBoot ? "启动方式: 寄存器镜像" : "启动方式: 逐项设置");
+  for (int i = 0; i < BOOT_PHASES; i++) {
+    Serial.print("  ");
+    Serial.print(bootPhaseNames[i]);
+    Serial.print(": ");
+    if (bootUs[i] == 0) {
+      Serial.println("-");
+    } else {
+      Serial.print(bootUs[i] / 1000);
+      Serial.println(" ms");
+    }
+  }
+  if (bootUs[BOOT_CARRIER] != 0) {
+    uint32_t carrierMs = bootUs[BOOT_CARRIER] / 1000;
+    Serial.print("上电到载波: ");
+    Serial.print(carrierMs);
+    Serial.print(" ms (预算 ");
+    Serial.print(BOOT_CARRIER_BUDGET_MS);
+    Serial.println(carrierMs > BOOT_CARRIER_BUDGET_MS ? " ms, 超出!)" : " ms)");
+  }
+}
+
+// 把10kHz单位的频率格式化为"88.10"，只用整数运算
+const char* formatFreq(uint16_t ch10kHz, char* buf) {
+  snprintf(buf, 8, "%u.%02u", ch10kHz / 100, ch10kHz % 100);
+  return buf;
+}
+
+// 解析"88.1"这样的定点数，结果乘以10^decimals（parseFixed("88.1", 2) == 8810）
+// 多余的小数位被截断，格式错误返回-1
+long parseFixed(const char* text, uint8_t decimals) {
+  while (*text == ' ') text++;
+  long value = 0;
+  bool digits = false;
+  while (*text >= '0' && *text <= '9') {
+    value = value * 10 + (*text++ - '0');
+    digits = true;
+    if (value > 100000000L) return -1;
+  }
+  uint8_t fraction = 0;
+  if (*text == '.') {
+    text++;
+    while (*text >= '0' && *text <= '9') {
+      if (fraction < decimals) {
+        value = value * 10 + (*text - '0');
+        fraction++;
+      }
+      text++;
+      digits = true;
+    }
+  }
+  while (*text == ' ') text++;
+  if (!digits || *text != '\0') return -1;
+  for (; fraction < decimals; fraction++) value *= 10;
+  return value;
+}
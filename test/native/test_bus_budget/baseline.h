@@ -0,0 +1,12 @@
+// written by test_bus_budget (BUS_BUDGET_WRITE), name, transactions, bytes, SCL clocks
+static const BusBudget baseline[] = {
+  {"setFrequency", 1, 3, 38},
+  {"sendRDS", 3, 13, 160},
+  {"sendStationName cycle", 63, 161, 2672},
+  {"sendRadioText cycle", 107, 333, 4904},
+  {"getFSMStatus", 1, 2, 39},
+  {"setup", 35, 1142, 10663},
+  {"updateDisplay full", 24, 1096, 10128},
+  {"updateDisplay one field", 3, 137, 1266},
+  {"updateDisplay unchanged", 0, 0, 0},
+};
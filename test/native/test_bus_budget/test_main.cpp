@@ -0,0 +1,225 @@
+/* I2C bus cost of QN8027Radio operations, firmware setup() and updateDisplay() on the simulated bus.
+   every case prints transactions, data bytes and bus time at 100 and 400 kHz and fails when it costs
+   more than baseline.h says. only the calling task is counted (Wire.watchTask), RDS and status tasks
+   running meanwhile do not change the numbers.
+
+   pio test -e native -f native/test_bus_budget -v
+   BUS_BUDGET_WRITE=test/native/test_bus_budget/baseline.h pio test -e native -f native/test_bus_budget
+   writes a new baseline, commit it together with the change that moved the numbers.
+*/
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <QN8027Radio.h>
+#include <QN8027Sim.h>
+#include <I2CDevices.h>
+#include <shim.h>
+#include <unity.h>
+
+struct BusBudget
+{
+  const char *name;
+  uint32_t transactions;
+  uint32_t bytes;          // data bytes written and read, without address bytes
+  uint64_t bits;           // SCL clocks, bus time at any clock rate follows from this
+};
+
+#include "baseline.h"
+
+#define BUDGET_MAX        16
+#define RDS_SLEEP_MAX_US  10000     // same as rdsTask in main.cpp
+
+// firmware, src/main.cpp (test_build_src = yes)
+void setup();
+void updateDisplay();
+extern bool shownValid;
+extern int txPower;
+
+static QN8027Sim chip;
+static I2CSink oledPanel;
+static BusBudget measured[BUDGET_MAX];
+static uint8_t measuredCount = 0;
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+static void startMeasure()
+{
+  Wire.watchTask(xTaskGetCurrentTaskHandle());
+}
+
+static void endMeasure(const char *name)
+{
+  WireStats s = Wire.watchedStats();
+  Wire.watchTask(NULL);
+  BusBudget now = {name, s.transactions, s.bytesWritten + s.bytesRead, s.bits};
+  if (measuredCount < BUDGET_MAX) measured[measuredCount++] = now;
+  printf("BUS %-24s %5u transactions %6u bytes %8llu us @100kHz %8llu us @400kHz\n", name, now.transactions,
+         now.bytes, (unsigned long long)s.busUsAt(100000), (unsigned long long)s.busUsAt(400000));
+  if (getenv("BUS_BUDGET_WRITE") != NULL) return;   // new baseline is being written, nothing to compare with
+
+  const BusBudget *base = NULL;
+  for (size_t i = 0; i < sizeof(baseline) / sizeof(baseline[0]); i++) {
+    if (strcmp(baseline[i].name, name) == 0) base = &baseline[i];
+  }
+  char message[96];
+  snprintf(message, sizeof(message), "%s has no baseline, write one with BUS_BUDGET_WRITE", name);
+  TEST_ASSERT_NOT_NULL_MESSAGE(base, message);
+  if (now.transactions < base->transactions || now.bytes < base->bytes || now.bits < base->bits) {
+    printf("BUS %-24s below baseline, write a new one to keep the gain\n", name);
+  }
+  snprintf(message, sizeof(message), "%s: more transactions than baseline", name);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32_MESSAGE(base->transactions, now.transactions, message);
+  snprintf(message, sizeof(message), "%s: more bytes than baseline", name);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32_MESSAGE(base->bytes, now.bytes, message);
+  snprintf(message, sizeof(message), "%s: longer bus time than baseline", name);
+  TEST_ASSERT_TRUE_MESSAGE(now.bits <= base->bits, message);
+}
+
+static void writeBaseline()
+{
+  const char *path = getenv("BUS_BUDGET_WRITE");
+  if (path == NULL) return;
+  FILE *out = fopen(path, "w");
+  if (out == NULL) {
+    printf("cannot write %s\n", path);
+    return;
+  }
+  fprintf(out, "// written by test_bus_budget (BUS_BUDGET_WRITE), name, transactions, bytes, SCL clocks\n");
+  fprintf(out, "static const BusBudget baseline[] = {\n");
+  for (uint8_t i = 0; i < measuredCount; i++) {
+    fprintf(out, "  {\"%s\", %u, %u, %llu},\n", measured[i].name, measured[i].transactions, measured[i].bytes,
+            (unsigned long long)measured[i].bits);
+  }
+  fprintf(out, "};\n");
+  fclose(out);
+}
+
+// chip on air with defaults, like after power on
+static void startTransmitter(QN8027Radio &tx)
+{
+  chip.powerOn();
+  delay(20);
+  tx.reset();
+  tx.reCalibrate();
+  tx.Switch(ON);
+  for (uint8_t i = 0; i < 100 && tx.getFSMStatus() != FSM_TRANSMITTING; i++) delay(1);
+  TEST_ASSERT_EQUAL(FSM_TRANSMITTING, tx.getFSMStatus());
+}
+
+// drives pollRDS() the way rdsTask does until chip has taken that many more groups
+static void sendGroups(QN8027Radio &tx, uint32_t groups)
+{
+  uint32_t target = tx.rdsGroupsSent + groups;
+  uint64_t giveUpUs = shimNowUs() + (uint64_t)groups * 2 * chip.timing.groupUs;
+  while (tx.rdsGroupsSent < target && shimNowUs() < giveUpUs) {
+    tx.pollRDS();
+    uint32_t wakeUs = tx.rdsWakeDelayUs();
+    if (wakeUs == 0 || wakeUs > RDS_SLEEP_MAX_US) wakeUs = RDS_SLEEP_MAX_US;
+    delayMicroseconds(wakeUs);
+  }
+  TEST_ASSERT_EQUAL(target, tx.rdsGroupsSent);
+}
+
+void test_set_frequency()
+{
+  QN8027Radio tx;
+  startTransmitter(tx);
+  startMeasure();
+  tx.setFrequency(101.7);
+  endMeasure("setFrequency");
+}
+
+void test_send_rds()
+{
+  QN8027Radio tx;
+  startTransmitter(tx);
+  tx.RDS(ON);
+  startMeasure();
+  tx.sendRDS(0x64, 0x00, 0x02, 0x68, 0xE0, 0xCD, 'F', 'M');
+  endMeasure("sendRDS");
+}
+
+// encoding costs nothing on the bus, the cost is one full cycle of the groups
+void test_send_station_name()
+{
+  QN8027Radio tx;
+  startTransmitter(tx);
+  tx.RDS(ON);
+  tx.setRDSPrediction(ON);
+  startMeasure();
+  tx.sendStationName("QN8027FM");
+  sendGroups(tx, RDS_PS_GROUPS);
+  endMeasure("sendStationName cycle");
+}
+
+void test_send_radio_text()
+{
+  QN8027Radio tx;
+  startTransmitter(tx);
+  tx.RDS(ON);
+  tx.setRDSPrediction(ON);
+  String text = "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef";
+  startMeasure();
+  tx.sendRadioText(text);
+  sendGroups(tx, RDS_RT_CHARS / 4);
+  endMeasure("sendRadioText cycle");
+}
+
+void test_get_fsm_status()
+{
+  QN8027Radio tx;
+  startTransmitter(tx);
+  startMeasure();
+  tx.getFSMStatus();
+  endMeasure("getFSMStatus");
+}
+
+// cold boot: no saved register image, every setting goes to the chip
+void test_firmware_setup()
+{
+  chip.powerOn();
+  delay(20);
+  startMeasure();
+  setup();
+  endMeasure("setup");
+}
+
+void test_update_display()
+{
+  delay(2000);                            // let tasks started by setup() settle
+  shownValid = false;
+  startMeasure();
+  updateDisplay();
+  endMeasure("updateDisplay full");
+
+  txPower--;
+  startMeasure();
+  updateDisplay();
+  endMeasure("updateDisplay one field");
+
+  startMeasure();
+  updateDisplay();
+  endMeasure("updateDisplay unchanged");
+}
+
+int main(int argc, char **argv)
+{
+  Wire.attach(QN8027_SIM_ADDR, &chip);
+  Wire.attach(0x3C, &oledPanel);
+  UNITY_BEGIN();
+  RUN_TEST(test_set_frequency);
+  RUN_TEST(test_send_rds);
+  RUN_TEST(test_send_station_name);
+  RUN_TEST(test_send_radio_text);
+  RUN_TEST(test_get_fsm_status);
+  RUN_TEST(test_firmware_setup);          // starts firmware tasks, library cases must run before it
+  RUN_TEST(test_update_display);
+  writeBaseline();
+  return UNITY_END();
+}
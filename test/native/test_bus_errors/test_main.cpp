@@ -0,0 +1,242 @@
+/* QN8027Radio retries, time budget and stuck bus recovery through I2CBus. pio test -e native -f native/test_bus_errors */
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <QN8027Radio.h>
+#include <I2CBus.h>
+#include <QN8027Sim.h>
+#include <shim.h>
+#include <unity.h>
+
+#define TEST_SDA 8
+#define TEST_SCL 9
+
+static QN8027Sim chip;
+static I2CBus bus(Wire);
+static uint8_t busRadio;
+
+static void radioBusHook(bool take)
+{
+  if (take) bus.acquire(busRadio);
+  else bus.release(busRadio);
+}
+
+static bool radioBusRecovery()
+{
+  return bus.recover();
+}
+
+static void onBus(QN8027Radio &tx)
+{
+  tx.setBusHook(radioBusHook);
+  tx.setBusRecovery(radioBusRecovery);
+}
+
+void setUp()
+{
+  chip.timing = QN8027SimTiming();
+  chip.nackNext = 0;
+  chip.powerOn();
+  delay(20);
+  bus.recoveries = 0;
+  bus.recoveryFailures = 0;
+}
+
+void tearDown()
+{
+  for (uint8_t i = 0; i < 20 && Wire.sdaHeld(); i++) bus.recover();
+}
+
+void test_nack_is_counted_per_register()
+{
+  QN8027Radio tx;
+  chip.nackNext = 100;
+  const uint8_t regs[] = {0x81, 0x86};
+  uint64_t startUs = shimNowUs();
+  TEST_ASSERT_FALSE(tx.writeBurst(FDEV_REG, regs, sizeof(regs)));
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(QN8027_I2C_BUDGET_US, shimNowUs() - startUs);
+  TEST_ASSERT_EQUAL(QN8027_I2C_NACK_DATA, tx.lastError);
+  TEST_ASSERT_EQUAL(QN8027_I2C_RETRIES + 1, tx.i2cErrors);
+  TEST_ASSERT_EQUAL(QN8027_I2C_RETRIES, tx.i2cRetries);
+  TEST_ASSERT_EQUAL(1, tx.i2cFailures);
+  TEST_ASSERT_EQUAL(QN8027_I2C_RETRIES + 1, tx.regErrors[FDEV_REG]);
+  TEST_ASSERT_EQUAL(QN8027_I2C_RETRIES + 1, tx.regErrors[RDS_REG]);
+  TEST_ASSERT_EQUAL(0, tx.regErrors[PAC_REG]);
+}
+
+void test_transient_nack_lands_after_retry()
+{
+  QN8027Radio tx;
+  chip.nackNext = 2;
+  TEST_ASSERT_TRUE(tx.write1Byte(PAC_REG, 0x50));
+  TEST_ASSERT_EQUAL_HEX8(0x50, chip.reg(PAC_REG));
+  TEST_ASSERT_EQUAL(0, tx.lastError);
+  TEST_ASSERT_EQUAL(2, tx.i2cRetries);
+  TEST_ASSERT_EQUAL(0, tx.i2cFailures);
+}
+
+// backoff doubles, so a long retry list is cut by the budget, not by the count
+void test_budget_limits_retries()
+{
+  QN8027Radio tx;
+  tx.setRetryPolicy(20, 4000);
+  chip.nackNext = 100;
+  uint64_t startUs = shimNowUs();
+  TEST_ASSERT_FALSE(tx.write1Byte(PAC_REG, 0x50));
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(4000, shimNowUs() - startUs);
+  TEST_ASSERT_TRUE(tx.i2cRetries < 20);
+  TEST_ASSERT_EQUAL(1, tx.i2cFailures);
+}
+
+void test_failed_setting_stays_dirty_until_flush()
+{
+  QN8027Radio tx;
+  tx.reset();
+  tx.setTxPower(60);
+  uint8_t power = chip.reg(PAC_REG) & 0x7F;
+  chip.nackNext = 100;
+  tx.setTxPower(40);
+  TEST_ASSERT_TRUE(tx.writesPending());
+  TEST_ASSERT_EQUAL(power, chip.reg(PAC_REG) & 0x7F);
+  chip.nackNext = 0;
+  TEST_ASSERT_TRUE(tx.flush());
+  TEST_ASSERT_FALSE(tx.writesPending());
+  TEST_ASSERT_EQUAL(tx.PAOutputPower, chip.reg(PAC_REG) & 0x7F);
+  TEST_ASSERT_TRUE(power != tx.PAOutputPower);
+}
+
+void test_failed_read_keeps_last_status()
+{
+  QN8027Radio tx;
+  StatusSnapshot good = tx.poll();
+  delay(5);
+  chip.nackNext = 100;
+  StatusSnapshot bad = tx.poll();
+  TEST_ASSERT_TRUE(tx.lastError != 0);
+  TEST_ASSERT_EQUAL(good.timeMs, bad.timeMs);
+  TEST_ASSERT_EQUAL_HEX8(good.raw, bad.raw);
+}
+
+void test_wait_for_rds_send_gives_up_on_dead_chip()
+{
+  QN8027Radio tx;
+  tx.reset();
+  tx.reCalibrate();
+  tx.beginUpdate();
+  tx.setChannel(9470);
+  tx.Switch(ON);
+  tx.RDS(ON);
+  TEST_ASSERT_TRUE(tx.endUpdate());
+  for (uint8_t i = 0; i < 100 && tx.getFSMStatus() != FSM_TRANSMITTING; i++) delay(1);
+  tx.sendRDS(0x64, 0x00, 0x02, 0x68, 0xE0, 0xCD, 'Q', 'N');
+  chip.nackNext = 255;
+  unsigned long startMs = millis();
+  TEST_ASSERT_FALSE(tx.waitForRDSSend());
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(RDS_TIMEOUT_MS + 10 + QN8027_I2C_BUDGET_US / 1000, millis() - startMs);
+  TEST_ASSERT_EQUAL(1, tx.rdsTimeouts);
+}
+
+// SYSTEM_REG holds channel bits 9:8, RDS toggle must not put new ones next to old CH1_REG (107.0 MHz high bits
+// with 88.0 MHz CH1_REG is 113.6 MHz)
+static void assertOldOrNewChannel()
+{
+  uint16_t channel = chip.channel();
+  TEST_ASSERT_TRUE(channel == 8800 || channel == 10700);
+}
+
+void test_rds_toggle_after_failed_retune_keeps_channel()
+{
+  QN8027Radio tx;
+  tx.reset();
+  tx.reCalibrate();
+  tx.beginUpdate();
+  tx.setChannel(8800);
+  tx.Switch(ON);
+  tx.RDS(ON);
+  TEST_ASSERT_TRUE(tx.endUpdate());
+  TEST_ASSERT_EQUAL(8800, chip.channel());
+
+  chip.nackNext = QN8027_I2C_RETRIES + 1;
+  tx.setChannel(10700);
+  TEST_ASSERT_TRUE(tx.writesPending());
+  assertOldOrNewChannel();
+
+  // status read and group do not land, no toggle: chip stays on old channel
+  chip.nackNext = 2 * (QN8027_I2C_RETRIES + 1);
+  tx.sendRDS(0x64, 0x00, 0x02, 0x68, 0xE0, 0xCD, 'Q', 'N');
+  TEST_ASSERT_EQUAL(8800, chip.channel());
+
+  // toggle takes retune with it in one burst
+  tx.sendRDS(0x64, 0x00, 0x02, 0x69, 0xE0, 0xCD, 'F', 'M');
+  assertOldOrNewChannel();
+  TEST_ASSERT_EQUAL(10700, chip.channel());
+  TEST_ASSERT_FALSE(tx.writesPending());
+
+  // clean registers: toggle flips only RDSRDY of what chip has
+  uint8_t system = chip.reg(SYSTEM_REG);
+  tx.sendRDS(0x64, 0x00, 0x02, 0x6A, 0xE0, 0xCD, ' ', ' ');
+  TEST_ASSERT_EQUAL_HEX8(system ^ 4, chip.reg(SYSTEM_REG));
+  TEST_ASSERT_EQUAL(10700, chip.channel());
+}
+
+// slave left in the middle of a byte: first attempt times out, SCL clocks free SDA, retry lands
+void test_stuck_sda_is_recovered()
+{
+  QN8027Radio tx;
+  onBus(tx);
+  Wire.holdSDA(7);
+  uint64_t startUs = shimNowUs();
+  TEST_ASSERT_TRUE(tx.write1Byte(PAC_REG, 0x51));
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(I2CBUS_TIMEOUT_MS * 1000 + 2000, shimNowUs() - startUs);
+  TEST_ASSERT_FALSE(Wire.sdaHeld());
+  TEST_ASSERT_EQUAL_HEX8(0x51, chip.reg(PAC_REG));
+  TEST_ASSERT_EQUAL(1, tx.busRecoveries);
+  TEST_ASSERT_EQUAL(1, tx.i2cRetries);
+  TEST_ASSERT_EQUAL(1, bus.recoveries);
+}
+
+void test_nack_does_not_touch_free_bus()
+{
+  QN8027Radio tx;
+  onBus(tx);
+  chip.nackNext = 1;
+  TEST_ASSERT_TRUE(tx.write1Byte(PAC_REG, 0x52));
+  TEST_ASSERT_FALSE(bus.recover());
+  TEST_ASSERT_EQUAL(0, tx.busRecoveries);
+  TEST_ASSERT_EQUAL(0, bus.recoveries);
+  TEST_ASSERT_EQUAL(0, bus.recoveryFailures);
+}
+
+// nine clocks are not enough: call still ends within budget plus one Wire timeout
+void test_bus_that_stays_stuck_fails_in_time()
+{
+  QN8027Radio tx;
+  onBus(tx);
+  Wire.holdSDA(100);
+  uint64_t startUs = shimNowUs();
+  TEST_ASSERT_FALSE(tx.write1Byte(PAC_REG, 0x53));
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(QN8027_I2C_BUDGET_US + I2CBUS_TIMEOUT_MS * 1000 + 1000, shimNowUs() - startUs);
+  TEST_ASSERT_EQUAL(5, tx.lastError);
+  TEST_ASSERT_EQUAL(1, tx.i2cFailures);
+  TEST_ASSERT_EQUAL(0, tx.busRecoveries);
+  TEST_ASSERT_EQUAL(tx.i2cErrors, bus.recoveryFailures);
+}
+
+int main(int argc, char **argv)
+{
+  Wire.attach(QN8027_SIM_ADDR, &chip);
+  busRadio = bus.addClient("radio");
+  bus.begin(TEST_SDA, TEST_SCL, 100000);
+  UNITY_BEGIN();
+  RUN_TEST(test_nack_is_counted_per_register);
+  RUN_TEST(test_transient_nack_lands_after_retry);
+  RUN_TEST(test_budget_limits_retries);
+  RUN_TEST(test_failed_setting_stays_dirty_until_flush);
+  RUN_TEST(test_failed_read_keeps_last_status);
+  RUN_TEST(test_wait_for_rds_send_gives_up_on_dead_chip);
+  RUN_TEST(test_rds_toggle_after_failed_retune_keeps_channel);
+  RUN_TEST(test_stuck_sda_is_recovered);
+  RUN_TEST(test_nack_does_not_touch_free_bus);
+  RUN_TEST(test_bus_that_stays_stuck_fails_in_time);
+  return UNITY_END();
+}
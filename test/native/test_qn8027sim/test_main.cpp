@@ -0,0 +1,223 @@
+/* QN8027Sim behaviour as QN8027Radio sees it. pio test -e native -f native/test_qn8027sim */
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <QN8027Radio.h>
+#include <QN8027Sim.h>
+#include <shim.h>
+#include <unity.h>
+
+static QN8027Sim chip;
+
+void setUp()
+{
+  chip.timing = QN8027SimTiming();
+  chip.powerOn();
+  chip.setInputMv(0);
+  chip.clearLog();
+  delay(20);                              // power on calibration
+}
+
+void tearDown()
+{
+}
+
+static void startTransmitter(QN8027Radio &tx)
+{
+  tx.reset();
+  tx.reCalibrate();
+  tx.Switch(ON);
+  for (uint8_t i = 0; i < 100 && tx.getFSMStatus() != FSM_TRANSMITTING; i++) delay(1);
+  TEST_ASSERT_EQUAL(FSM_TRANSMITTING, tx.getFSMStatus());
+}
+
+void test_reset_and_recalibration_sequence()
+{
+  QN8027Radio tx;
+  tx.reset();
+  TEST_ASSERT_EQUAL(SIM_FSM_RESETTING, tx.getFSMStatus());
+  tx.reCalibrate();
+  delay(5);
+  TEST_ASSERT_EQUAL(SIM_FSM_RESETTING, tx.getFSMStatus());   // held while RECAL is set
+
+  tx.Switch(ON);                          // clears RECAL and requests transmission
+  uint64_t startUs = shimNowUs();
+  uint8_t seen[8];
+  uint8_t count = 0;
+  while (count < sizeof(seen) && shimNowUs() - startUs < 100000) {
+    uint8_t fsm = tx.getFSMStatus();
+    if (count == 0 || seen[count - 1] != fsm) seen[count++] = fsm;
+    if (fsm == FSM_TRANSMITTING) break;
+    delayMicroseconds(250);
+  }
+  const uint8_t expected[] = {SIM_FSM_RECALIBRATING, SIM_FSM_TX_READY, SIM_FSM_PA_CALIBRATION, SIM_FSM_TRANSMITTING};
+  TEST_ASSERT_EQUAL(sizeof(expected), count);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, seen, sizeof(expected));
+  uint32_t sequenceUs = chip.timing.recalUs + chip.timing.txReadyUs + chip.timing.paCalUs;
+  TEST_ASSERT_UINT32_WITHIN(1000, sequenceUs, shimNowUs() - startUs);
+
+  tx.Switch(OFF);
+  TEST_ASSERT_EQUAL(SIM_FSM_IDLE, tx.getFSMStatus());
+}
+
+void test_soft_reset_restores_defaults()
+{
+  QN8027Radio tx;
+  startTransmitter(tx);
+  tx.setTxPower(40);
+  TEST_ASSERT_EQUAL_HEX8(40, chip.reg(PAC_REG) & 0x7F);
+  uint32_t resets = chip.resets;
+  tx.reset();
+  TEST_ASSERT_EQUAL_HEX8(0x7F, chip.reg(PAC_REG));
+  TEST_ASSERT_EQUAL_HEX8(0x00, chip.reg(SYSTEM_REG));
+  TEST_ASSERT_EQUAL(resets + 1, chip.resets);
+}
+
+void test_rds_group_taken_every_group_period()
+{
+  QN8027Radio tx;
+  startTransmitter(tx);
+  tx.RDS(ON);
+  for (uint8_t i = 0; i < 4; i++) {
+    tx.sendRDS(0x64, 0x00, 0x02, 0x68 + i, 0xE0, 0xCD, 'A' + i, 'a' + i);
+    TEST_ASSERT_TRUE(tx.waitForRDSSend());
+  }
+  const std::vector<QN8027SimGroup> &groups = chip.groups();
+  TEST_ASSERT_EQUAL(4, groups.size());
+  for (uint8_t i = 0; i < 4; i++) TEST_ASSERT_EQUAL_HEX8(0x68 + i, groups[i].data[3]);
+  // each group was latched before the chip finished the previous one, so they leave back to back
+  for (uint8_t i = 1; i < 4; i++) TEST_ASSERT_EQUAL_UINT64(chip.timing.groupUs, groups[i].timeUs - groups[i - 1].timeUs);
+  TEST_ASSERT_EQUAL(4, tx.rdsGroupsSent);
+}
+
+void test_rds_not_taken_without_enable()
+{
+  QN8027Radio tx;
+  startTransmitter(tx);
+  tx.RDS(OFF);
+  uint8_t toggle = chip.reg(STATUS_REG) & 8;
+  tx.sendRDS(0x64, 0x00, 0x02, 0x68, 0xE0, 0xCD, 'A', 'B');
+  TEST_ASSERT_FALSE(tx.waitForRDSSend());
+  TEST_ASSERT_EQUAL(0, chip.groups().size());
+  TEST_ASSERT_EQUAL(toggle, chip.reg(STATUS_REG) & 8);
+}
+
+void test_retune_calibrates_pa_again()
+{
+  QN8027Radio tx;
+  startTransmitter(tx);
+  tx.setChannel(8810);
+  TEST_ASSERT_EQUAL(8810, chip.channel());
+  TEST_ASSERT_EQUAL(1, chip.retunes);       // SYSTEM and CH1 in one burst is one retune
+  TEST_ASSERT_EQUAL(SIM_FSM_PA_CALIBRATION, chip.fsm());
+  while (tx.getFSMStatus() != FSM_TRANSMITTING) delayMicroseconds(500);
+  TEST_ASSERT_TRUE(tx.retuneDeadAir);
+  TEST_ASSERT_UINT32_WITHIN(1000, chip.timing.retuneUs, tx.retuneLatencyUs);
+}
+
+// 88.00 and 100.80 MHz have same CH1_REG (0xF0), only channel bits of SYSTEM_REG differ
+void test_hop_with_same_low_byte_retunes()
+{
+  QN8027Radio tx;
+  startTransmitter(tx);
+  tx.RDS(OFF);
+  tx.setChannel(8800);
+  TEST_ASSERT_EQUAL(8800, chip.channel());
+  uint32_t retunes = chip.retunes;
+  tx.setChannel(10080);
+  TEST_ASSERT_EQUAL(1, chip.reg(SYSTEM_REG) & 3);
+  TEST_ASSERT_EQUAL_HEX8(0xF0, chip.reg(CH1_REG));
+  TEST_ASSERT_EQUAL(10080, chip.channel());
+  TEST_ASSERT_EQUAL(retunes + 1, chip.retunes);
+}
+
+void test_audio_peak_holds_until_cleared()
+{
+  QN8027Radio tx;
+  startTransmitter(tx);
+  chip.setInputMv(450);
+  TEST_ASSERT_EQUAL(10, tx.getAudioInpPeak());
+  chip.setInputMv(90);
+  TEST_ASSERT_EQUAL(10, tx.getAudioInpPeak());
+  tx.clearAudioPeak();
+  TEST_ASSERT_EQUAL(2, tx.getAudioInpPeak());
+
+  // short burst between two reads is still caught
+  uint32_t nowMs = shimNowUs() / 1000;
+  const QN8027SimLevel burst[] = {{nowMs + 100, 900}, {nowMs + 150, 0}};
+  chip.setInputScript(burst, 2);
+  delay(300);
+  TEST_ASSERT_EQUAL(15, tx.getAudioInpPeak());
+  tx.clearAudioPeak();
+  TEST_ASSERT_EQUAL(0, tx.getAudioInpPeak());
+}
+
+void test_audio_peak_follows_input_gain()
+{
+  QN8027Radio tx;
+  startTransmitter(tx);
+  tx.setPeakClearPolicy(PEAK_CLEAR_ON_POLL);
+  chip.setInputMv(225);
+  tx.poll();
+  TEST_ASSERT_EQUAL(5, tx.poll().audioPeak);
+  tx.setTxInputBufferGain(5);             // +6 dB
+  tx.poll();
+  TEST_ASSERT_EQUAL(9, tx.poll().audioPeak);
+}
+
+void test_pa_turns_off_after_silence()
+{
+  QN8027Radio tx;
+  startTransmitter(tx);
+  tx.radioNoAudioAutoOFF(ON);             // 60 s
+  delay(59000);
+  TEST_ASSERT_EQUAL(SIM_FSM_TRANSMITTING, chip.fsm());
+  delay(2000);
+  TEST_ASSERT_EQUAL(SIM_FSM_PA_OFF, tx.getFSMStatus());
+  TEST_ASSERT_EQUAL(1, chip.paOffs);
+  chip.setInputMv(450);
+  delay(chip.timing.paCalUs / 1000 + 1);
+  TEST_ASSERT_EQUAL(SIM_FSM_TRANSMITTING, tx.getFSMStatus());
+}
+
+void test_transactions_are_logged_with_time()
+{
+  QN8027Radio tx;
+  startTransmitter(tx);
+  chip.clearLog();
+  uint64_t writeUs = shimNowUs();
+  const uint8_t regs[] = {0x40, 0x81, 0x86};
+  tx.writeRegs(PAC_REG, regs, sizeof(regs));
+  uint64_t readUs = shimNowUs();
+  tx.read1Byte(CID2_REG);
+
+  const std::vector<QN8027SimTransaction> &log = chip.transactions();
+  TEST_ASSERT_EQUAL(3, log.size());         // burst write, register pointer, read after repeated START
+  TEST_ASSERT_FALSE(log[0].read);
+  TEST_ASSERT_EQUAL_HEX8(PAC_REG, log[0].reg);
+  TEST_ASSERT_EQUAL(3, log[0].len);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(regs, log[0].data, 3);
+  TEST_ASSERT_EQUAL_UINT64(writeUs, log[0].timeUs);
+  TEST_ASSERT_EQUAL(0, log[1].len);
+  TEST_ASSERT_TRUE(log[2].read);
+  TEST_ASSERT_EQUAL_HEX8(CID2_REG, log[2].reg);
+  TEST_ASSERT_EQUAL_HEX8(0x40, log[2].data[0]);
+  TEST_ASSERT_EQUAL_UINT64(readUs, log[2].timeUs);
+}
+
+int main(int argc, char **argv)
+{
+  Wire.attach(QN8027_SIM_ADDR, &chip);
+  UNITY_BEGIN();
+  RUN_TEST(test_reset_and_recalibration_sequence);
+  RUN_TEST(test_soft_reset_restores_defaults);
+  RUN_TEST(test_rds_group_taken_every_group_period);
+  RUN_TEST(test_rds_not_taken_without_enable);
+  RUN_TEST(test_retune_calibrates_pa_again);
+  RUN_TEST(test_hop_with_same_low_byte_retunes);
+  RUN_TEST(test_audio_peak_holds_until_cleared);
+  RUN_TEST(test_audio_peak_follows_input_gain);
+  RUN_TEST(test_pa_turns_off_after_silence);
+  RUN_TEST(test_transactions_are_logged_with_time);
+  return UNITY_END();
+}
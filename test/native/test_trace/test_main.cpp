@@ -0,0 +1,203 @@
+/* QN8027Trace recording from QN8027Radio and QN8027Replay of it into the model. pio test -e native -f native/test_trace */
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <QN8027Radio.h>
+#include <QN8027Trace.h>
+#include <QN8027Sim.h>
+#include <QN8027Replay.h>
+#include <shim.h>
+#include <unity.h>
+#include <vector>
+
+static QN8027Sim chip;
+static QN8027Trace trace;
+
+void setUp()
+{
+  chip.timing = QN8027SimTiming();
+  chip.powerOn();
+  delay(20);
+  TEST_ASSERT_TRUE(trace.begin(4096));
+}
+
+void tearDown()
+{
+  trace.end();
+}
+
+static std::vector<uint8_t> traceImage()
+{
+  std::vector<uint8_t> image(trace.imageSize());
+  TEST_ASSERT_EQUAL(image.size(), trace.copy(image.data(), image.size()));
+  return image;
+}
+
+// what setup() does to a cold chip, then some RDS and status reads
+static void session(QN8027Radio &tx)
+{
+  tx.reset();
+  tx.reCalibrate();
+  tx.beginUpdate();
+  tx.setChannel(9470);
+  tx.setTxPower(60);
+  tx.Switch(ON);
+  tx.RDS(ON);
+  tx.endUpdate();
+  for (uint8_t i = 0; i < 100 && tx.getFSMStatus() != FSM_TRANSMITTING; i++) delay(1);
+  for (uint8_t i = 0; i < 3; i++) {
+    tx.sendRDS(0x64, 0x00, 0x02, 0x68 + i, 0xE0, 0xCD, 'Q', 'N');
+    TEST_ASSERT_TRUE(tx.waitForRDSSend());
+  }
+}
+
+void test_reads_and_writes_are_recorded()
+{
+  QN8027Radio tx;
+  tx.setTrace(&trace);
+  uint32_t writeUs = micros();
+  tx.write1Byte(PAC_REG, 0x50);
+  const uint8_t regs[] = {0x81, 0x86};
+  tx.writeBurst(FDEV_REG, regs, sizeof(regs));
+  uint32_t readUs = micros();
+  uint8_t status[2];
+  tx.readBurst(CID2_REG, status, sizeof(status));
+
+  std::vector<uint8_t> image = traceImage();
+  QN8027TraceReader reader(image.data(), image.size());
+  TEST_ASSERT_TRUE(reader.valid());
+  QN8027TraceRecord rec;
+  TEST_ASSERT_TRUE(reader.next(&rec));
+  TEST_ASSERT_FALSE(rec.read);
+  TEST_ASSERT_EQUAL_HEX8(QN8027_I2C_ADDR, rec.address);
+  TEST_ASSERT_EQUAL_HEX8(PAC_REG, rec.reg);
+  TEST_ASSERT_EQUAL(1, rec.len);
+  TEST_ASSERT_EQUAL_HEX8(0x50, rec.data[0]);
+  TEST_ASSERT_EQUAL(0, rec.result);
+  TEST_ASSERT_EQUAL_UINT32(writeUs, rec.timeUs);
+
+  TEST_ASSERT_TRUE(reader.next(&rec));
+  TEST_ASSERT_EQUAL_HEX8(FDEV_REG, rec.reg);
+  TEST_ASSERT_EQUAL(2, rec.len);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(regs, rec.data, 2);
+
+  TEST_ASSERT_TRUE(reader.next(&rec));
+  TEST_ASSERT_TRUE(rec.read);
+  TEST_ASSERT_EQUAL_HEX8(CID2_REG, rec.reg);
+  TEST_ASSERT_EQUAL(2, rec.len);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(status, rec.data, 2);
+  TEST_ASSERT_EQUAL_UINT32(readUs, rec.timeUs);
+  TEST_ASSERT_FALSE(reader.next(&rec));
+  TEST_ASSERT_EQUAL(3, trace.records);
+}
+
+void test_nack_is_recorded()
+{
+  QN8027Radio tx(QN8027_I2C_ADDR + 1);      // nothing there
+  tx.setTrace(&trace);
+  tx.write1Byte(PAC_REG, 0x50);
+  tx.read1Byte(STATUS_REG);
+
+  std::vector<uint8_t> image = traceImage();
+  QN8027TraceReader reader(image.data(), image.size());
+  QN8027TraceRecord rec;
+  TEST_ASSERT_TRUE(reader.next(&rec));
+  TEST_ASSERT_EQUAL(2, rec.result);         // address NACK
+  TEST_ASSERT_TRUE(reader.next(&rec));
+  TEST_ASSERT_TRUE(rec.result != 0);
+}
+
+void test_ring_drops_oldest_records()
+{
+  TEST_ASSERT_TRUE(trace.begin(100));       // 11 one byte writes (9 bytes each) fit
+  QN8027Radio tx;
+  tx.setTrace(&trace);
+  for (uint8_t i = 0; i < 20; i++) tx.write1Byte(PAC_REG, i);
+  TEST_ASSERT_EQUAL(20, trace.recorded);
+  TEST_ASSERT_EQUAL(11, trace.records);
+  TEST_ASSERT_EQUAL(9, trace.dropped);
+
+  std::vector<uint8_t> image = traceImage();
+  QN8027TraceReader reader(image.data(), image.size());
+  TEST_ASSERT_EQUAL(9, reader.dropped);
+  QN8027TraceRecord rec;
+  for (uint8_t i = 9; i < 20; i++) {
+    TEST_ASSERT_TRUE(reader.next(&rec));
+    TEST_ASSERT_EQUAL_HEX8(i, rec.data[0]);
+  }
+  TEST_ASSERT_FALSE(reader.next(&rec));
+}
+
+void test_stopped_trace_keeps_records()
+{
+  QN8027Radio tx;
+  tx.setTrace(&trace);
+  tx.write1Byte(PAC_REG, 0x50);
+  trace.stop();
+  tx.write1Byte(PAC_REG, 0x51);
+  TEST_ASSERT_EQUAL(1, trace.records);
+  trace.start();
+  tx.write1Byte(PAC_REG, 0x52);
+  TEST_ASSERT_EQUAL(2, trace.records);
+}
+
+void test_replay_of_recorded_session_matches()
+{
+  QN8027Radio tx;
+  tx.setTrace(&trace);
+  session(tx);
+  std::vector<uint8_t> image = traceImage();
+  uint32_t groups = chip.groups().size();
+  chip.clearLog();
+
+  QN8027Replay replay(chip, NULL);
+  TEST_ASSERT_TRUE(replay.run(image.data(), image.size()));
+  TEST_ASSERT_EQUAL(trace.records, replay.result.records);
+  TEST_ASSERT_EQUAL(0, replay.result.readDiffs);
+  TEST_ASSERT_EQUAL(0, replay.result.resultDiffs);
+  TEST_ASSERT_EQUAL(0, replay.result.stateDiffs);
+  TEST_ASSERT_EQUAL(0, replay.result.late);
+  TEST_ASSERT_EQUAL_UINT64(QN8027_SIM_NO_EVENT, replay.result.firstDiffUs);
+  TEST_ASSERT_EQUAL(groups, chip.groups().size());
+  TEST_ASSERT_EQUAL(9470, chip.channel());
+}
+
+// chip in the field calibrates PA faster than the model: replay shows where STATUS went different ways
+void test_replay_finds_timing_difference()
+{
+  chip.timing.paCalUs = 2000;
+  chip.powerOn();
+  delay(20);
+  QN8027Radio tx;
+  tx.setTrace(&trace);
+  session(tx);
+  std::vector<uint8_t> image = traceImage();
+
+  chip.timing = QN8027SimTiming();
+  QN8027Replay replay(chip, NULL);
+  TEST_ASSERT_TRUE(replay.run(image.data(), image.size()));
+  TEST_ASSERT_GREATER_THAN(0, replay.result.readDiffs);
+  TEST_ASSERT_TRUE(replay.result.firstDiffUs != QN8027_SIM_NO_EVENT);
+  TEST_ASSERT_TRUE(replay.result.firstDiffUs < replay.result.traceUs);
+}
+
+void test_replay_rejects_other_data()
+{
+  const uint8_t junk[] = "not a trace";
+  QN8027Replay replay(chip, NULL);
+  TEST_ASSERT_FALSE(replay.run(junk, sizeof(junk)));
+}
+
+int main(int argc, char **argv)
+{
+  Wire.attach(QN8027_SIM_ADDR, &chip);
+  UNITY_BEGIN();
+  RUN_TEST(test_reads_and_writes_are_recorded);
+  RUN_TEST(test_nack_is_recorded);
+  RUN_TEST(test_ring_drops_oldest_records);
+  RUN_TEST(test_stopped_trace_keeps_records);
+  RUN_TEST(test_replay_of_recorded_session_matches);
+  RUN_TEST(test_replay_finds_timing_difference);
+  RUN_TEST(test_replay_rejects_other_data);
+  return UNITY_END();
+}
@@ -0,0 +1,61 @@
+#!/usr/bin/env python3
+"""Throughput benchmark for the binary control protocol.
+
+Measures commands per second and round-trip latency for a few request types,
+one at a time (--window 1) or pipelined (--window N requests in flight).
+
+    python3 tools/fmbench.py /dev/ttyACM0 --count 1000 --window 4
+"""
+
+import argparse
+import statistics
+import time
+
+from fmlink import Cmd, FMLink, Param
+
+
+def run(fm, name, make_request, count, window):
+    latencies = []
+    in_flight = []
+    start = time.perf_counter()
+    for i in range(count):
+        cmd, payload = make_request(i)
+        in_flight.append((time.perf_counter(), fm.send(cmd, payload)))
+        if len(in_flight) >= window:
+            sent, handle = in_flight.pop(0)
+            fm.wait(handle)
+            latencies.append(time.perf_counter() - sent)
+    for sent, handle in in_flight:
+        fm.wait(handle)
+        latencies.append(time.perf_counter() - sent)
+    elapsed = time.perf_counter() - start
+
+    latencies.sort()
+    p99 = latencies[min(len(latencies) - 1, int(len(latencies) * 0.99))]
+    print("%-10s %8.0f cmd/s   latency avg %6.2f ms  p50 %6.2f ms  p99 %6.2f ms" %
+          (name, count / elapsed, statistics.mean(latencies) * 1000,
+           latencies[len(latencies) // 2] * 1000, p99 * 1000))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("port")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--count", type=int, default=500)
+    parser.add_argument("--window", type=int, default=1, help="requests in flight")
+    args = parser.parse_args()
+
+    with FMLink(args.port, args.baud, timeout=2.0) as fm:
+        fm.ping()
+        power = fm.get(Param.POWER)
+        run(fm, "ping", lambda i: (Cmd.PING, b""), args.count, args.window)
+        run(fm, "get", lambda i: (Cmd.GET, bytes([Param.POWER])), args.count, args.window)
+        run(fm, "set", lambda i: (Cmd.SET, bytes([Param.POWER]) + power.to_bytes(4, "little")),
+            args.count, args.window)
+        run(fm, "reg_read", lambda i: (Cmd.REG_READ, bytes([0, 0x13])), args.count, args.window)
+        if fm.bad_frames:
+            print("frames skipped (text or damaged): %d" % fm.bad_frames)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,331 @@
+#!/usr/bin/env python3
+"""Host client for the QN8027 transmitter's binary control protocol.
+
+Frames are COBS encoded and delimited by 0x00 on both sides:
+
+    request:   cmd, seq, payload...            + CRC-16/CCITT-FALSE (little endian)
+    reply:     cmd | 0x80, seq, status, data... + CRC
+    telemetry: 0x40, seq, data...               + CRC
+
+Text printed by the firmware on the same port is skipped, because only bytes
+between two 0x00 delimiters that pass the CRC check count as frames.
+
+Example:
+    with FMLink("/dev/ttyACM0") as fm:
+        fm.set(Param.FREQ, 8810)
+        fm.set_text(Param.RADIO_TEXT, "Hello")
+        print(fm.get(Param.POWER), fm.reg_read(0x00, 0x13).hex())
+"""
+
+import binascii
+import enum
+import queue
+import struct
+import threading
+import time
+
+import serial  # pyserial
+
+
+class Cmd(enum.IntEnum):
+    PING = 0x01
+    GET = 0x02
+    SET = 0x03
+    REG_READ = 0x04
+    REG_WRITE = 0x05
+    RDS_GROUP = 0x06
+    SUBSCRIBE = 0x07
+    SAVE = 0x08
+    TELEMETRY = 0x40
+    REPLY = 0x80
+
+
+class Status(enum.IntEnum):
+    OK = 0
+    ERR_COMMAND = 1
+    ERR_LENGTH = 2
+    ERR_PARAM = 3
+    ERR_VALUE = 4
+    ERR_FULL = 5
+    ERR_BUS = 6             # QN8027 did not answer after retries
+
+
+def status_name(code):
+    """Name of a reply status, or its number when this tool does not know it."""
+    try:
+        return Status(code).name
+    except ValueError:
+        return "status %d" % code
+
+
+class Param(enum.IntEnum):
+    """Same numbering as ParamId in src/main.cpp."""
+    FREQ = 1                # 10 kHz units, 8810 == 88.10 MHz
+    POWER = 2               # 0-100 %
+    DEVIATION = 3           # register value, x 0.58 kHz
+    PILOT = 4               # 7-10 % of 75 kHz
+    RDS_DEVIATION = 5       # register value, x 0.35 kHz
+    RDS = 6
+    RDS_MIX = 7             # station name groups per second
+    MONO = 8
+    PREEMPH_50 = 9          # 1 == 50 us, 0 == 75 us
+    MUTE = 10
+    SCRAMBLE = 11
+    RADIO = 12
+    AUTO_OFF = 13           # read only, firmware handles silence itself
+    INPUT_GAIN = 14         # 0-5
+    DIGITAL_GAIN = 15       # 0-2 dB
+    IMPEDANCE = 16          # 5/10/20/40 kOhm
+    CRYSTAL = 17            # 12/24 MHz
+    CLOCK = 18              # 0-3
+    CRYSTAL_CURRENT = 19    # 0.1 % of 400 uA
+    AGC = 20
+    SILENCE_THRESHOLD = 21  # audio peak 1-15
+    SILENCE_HOLD = 22       # ms
+    SILENCE_RECOVER = 23    # ms
+    SILENCE_MUTE = 24
+    RDS_PREDICTION = 25
+    PEAK_CLEAR_POLICY = 26  # 1 == cleared after every status sample, 0 == manual
+    STATION_NAME = 32
+    RADIO_TEXT = 33
+    FALLBACK_TEXT = 34
+
+
+TEXT_PARAMS = (Param.STATION_NAME, Param.RADIO_TEXT, Param.FALLBACK_TEXT)
+
+
+class FMError(Exception):
+    pass
+
+
+def crc16(data):
+    return binascii.crc_hqx(data, 0xFFFF)
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code_at, code = 0, 1
+    for b in data:
+        if b == 0:
+            out[code_at] = code
+            code_at, code = len(out), 1
+            out.append(0)
+        else:
+            out.append(b)
+            code += 1
+            if code == 0xFF:
+                out[code_at] = code
+                code_at, code = len(out), 1
+                out.append(0)
+    out[code_at] = code
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        i += 1
+        if code == 0 or i + code - 1 > len(data):
+            raise ValueError("bad COBS")
+        out += data[i:i + code - 1]
+        i += code - 1
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def encode_frame(msg):
+    return b"\x00" + cobs_encode(msg + struct.pack("<H", crc16(msg))) + b"\x00"
+
+
+def decode_frame(body):
+    """Returns the message without CRC, or None if the frame is damaged."""
+    try:
+        raw = cobs_decode(body)
+    except ValueError:
+        return None
+    if len(raw) < 3 or struct.unpack("<H", raw[-2:])[0] != crc16(raw[:-2]):
+        return None
+    return raw[:-2]
+
+
+class Telemetry:
+    FORMAT = struct.Struct("<BBBHIIBBH")
+
+    def __init__(self, seq, data):
+        self.seq = seq
+        (self.fsm, self.peak, flags, self.freq10k, self.time_ms, self.rds_groups,
+         self.input_gain, self.deviation, self.bad_frames) = self.FORMAT.unpack(data[:self.FORMAT.size])
+        self.silent = bool(flags & 1)
+        self.agc = bool(flags & 2)
+        self.wifi = bool(flags & 4)
+
+    def __repr__(self):
+        return ("Telemetry(seq=%d fsm=%d peak=%d freq=%.2f silent=%s rds=%d gain=%d dev=%d)" %
+                (self.seq, self.fsm, self.peak, self.freq10k / 100, self.silent,
+                 self.rds_groups, self.input_gain, self.deviation))
+
+
+class FMLink:
+    def __init__(self, port, baudrate=115200, timeout=0.5, retries=2):
+        self.ser = serial.Serial(port, baudrate, timeout=0.05)
+        self.timeout = timeout
+        self.retries = retries
+        self.telemetry = queue.Queue(maxsize=1000)
+        self.bad_frames = 0
+        self._seq = 0
+        self._pending = {}
+        self._lock = threading.Lock()
+        self._running = True
+        self._reader = threading.Thread(target=self._read_loop, daemon=True)
+        self._reader.start()
+
+    def close(self):
+        self._running = False
+        self._reader.join()
+        self.ser.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def _read_loop(self):
+        buf = bytearray()
+        while self._running:
+            chunk = self.ser.read(self.ser.in_waiting or 1)
+            if not chunk:
+                continue
+            buf += chunk
+            while True:
+                end = buf.find(0)
+                if end < 0:
+                    break
+                body = bytes(buf[:end])
+                del buf[:end + 1]
+                if body:
+                    self._dispatch(body)
+
+    def _dispatch(self, body):
+        msg = decode_frame(body)
+        if msg is None:
+            # printed text or a damaged frame
+            self.bad_frames += 1
+            return
+        if msg[0] == Cmd.TELEMETRY:
+            try:
+                self.telemetry.put_nowait(Telemetry(msg[1], msg[2:]))
+            except queue.Full:
+                pass
+            return
+        with self._lock:
+            waiter = self._pending.pop(msg[1], None)
+        if waiter is not None and msg[0] == waiter[0] | Cmd.REPLY:
+            waiter[1].put(msg)
+
+    def send(self, cmd, payload=b""):
+        """Sends a request without waiting. Returns a handle for wait()."""
+        with self._lock:
+            seq = self._seq
+            self._seq = (self._seq + 1) & 0xFF
+            box = queue.Queue(maxsize=1)
+            self._pending[seq] = (cmd, box)
+        self.ser.write(encode_frame(bytes([cmd, seq]) + payload))
+        return (cmd, seq, payload, box)
+
+    def wait(self, handle):
+        """Waits for the reply of send(). Returns the reply data after the status byte."""
+        cmd, seq, payload, box = handle
+        try:
+            msg = box.get(timeout=self.timeout)
+        except queue.Empty:
+            with self._lock:
+                self._pending.pop(seq, None)
+            raise FMError("no reply to command 0x%02x seq %d" % (cmd, seq))
+        if msg[2] != Status.OK:
+            raise FMError("command 0x%02x failed: %s" % (cmd, status_name(msg[2])))
+        return msg[3:]
+
+    def request(self, cmd, payload=b""):
+        for attempt in range(self.retries + 1):
+            try:
+                return self.wait(self.send(cmd, payload))
+            except FMError as e:
+                if "no reply" not in str(e) or attempt == self.retries:
+                    raise
+
+    def ping(self, data=b""):
+        return self.request(Cmd.PING, data)
+
+    def get(self, param):
+        data = self.request(Cmd.GET, bytes([param]))
+        if param in TEXT_PARAMS:
+            return data[1:].decode("utf-8", "replace")
+        return struct.unpack("<i", data[1:5])[0]
+
+    def set(self, param, value):
+        if param in TEXT_PARAMS:
+            return self.set_text(param, value)
+        self.request(Cmd.SET, struct.pack("<Bi", param, value))
+
+    def set_text(self, param, text):
+        self.request(Cmd.SET, bytes([param]) + text.encode("utf-8")[:64])
+
+    def reg_read(self, start, count=1):
+        return self.request(Cmd.REG_READ, bytes([start, count]))
+
+    def reg_write(self, start, values):
+        self.request(Cmd.REG_WRITE, bytes([start]) + bytes(values))
+
+    def rds_group(self, group):
+        if len(group) != 8:
+            raise ValueError("RDS group is 8 bytes")
+        self.request(Cmd.RDS_GROUP, bytes(group))
+
+    def subscribe(self, interval_ms):
+        """Telemetry every interval_ms (0 stops). Frames arrive in self.telemetry."""
+        self.request(Cmd.SUBSCRIBE, struct.pack("<H", interval_ms))
+
+    def save(self):
+        self.request(Cmd.SAVE)
+
+
+if __name__ == "__main__":
+    import argparse
+
+    parser = argparse.ArgumentParser(description="QN8027 transmitter binary protocol client")
+    parser.add_argument("port")
+    parser.add_argument("--baud", type=int, default=115200)
+    sub = parser.add_subparsers(dest="action", required=True)
+    p = sub.add_parser("get")
+    p.add_argument("param")
+    p = sub.add_parser("set")
+    p.add_argument("param")
+    p.add_argument("value")
+    p = sub.add_parser("regs")
+    p = sub.add_parser("watch")
+    p.add_argument("--interval", type=int, default=100)
+    sub.add_parser("save")
+    args = parser.parse_args()
+
+    with FMLink(args.port, args.baud) as fm:
+        if args.action == "get":
+            print(fm.get(Param[args.param.upper()]))
+        elif args.action == "set":
+            param = Param[args.param.upper()]
+            fm.set(param, args.value if param in TEXT_PARAMS else int(args.value, 0))
+        elif args.action == "regs":
+            for i, v in enumerate(fm.reg_read(0, 0x13)):
+                print("0x%02X: 0x%02X" % (i, v))
+        elif args.action == "watch":
+            fm.subscribe(args.interval)
+            try:
+                while True:
+                    print(fm.telemetry.get())
+            except KeyboardInterrupt:
+                fm.subscribe(0)
+        elif args.action == "save":
+            fm.save()